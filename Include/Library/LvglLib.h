@@ -11,6 +11,7 @@
 #define __LVGL_LIB_H__
 
 #include <lvgl.h>
+#include <Library/LvglMemoryLib.h>
 
 typedef
 VOID
@@ -18,6 +19,35 @@ VOID
   VOID
   );
 
+///
+/// Refresh mode picked by the LvglLib refresh governor.
+///
+typedef enum {
+  LvglRefreshIdle,        ///< Nothing to draw, refresh and input timers paused.
+  LvglRefreshOnDemand,    ///< Invalidated areas or pressed input, PcdLvglRefreshDemandHz.
+  LvglRefreshAnimated     ///< Animations or scrolling, PcdLvglRefreshTargetHz.
+} LVGL_REFRESH_MODE;
+
+typedef struct {
+  LVGL_REFRESH_MODE  Mode;
+  UINT32             RateHz;          ///< 0 when idle.
+  UINT32             ModeChanges;     ///< Mode changes since UefiLvglInit.
+  UINT32             MsInMode;        ///< Time since the last mode change.
+} LVGL_REFRESH_STATE;
+
+///
+/// Latency from input data returned by the firmware to the first flush
+/// showing its result, see UefiLvglGetInputLatency.
+///
+typedef struct {
+  UINT32             Samples;         ///< Inputs whose result was flushed.
+  UINT32             Unshown;         ///< Inputs that changed nothing on the screen.
+  UINT32             P50Us;
+  UINT32             P95Us;
+  UINT32             P99Us;
+  UINT32             MaxUs;
+} LVGL_INPUT_LATENCY;
+
 EFI_STATUS
 EFIAPI
 UefiLvglInit (
@@ -36,4 +66,17 @@ UefiLvglAppRegister (
   IN EFI_LVGL_APP_FUNCTION AppRegister
   );
 
+EFI_STATUS
+EFIAPI
+UefiLvglGetRefreshState (
+  OUT LVGL_REFRESH_STATE  *State
+  );
+
+EFI_STATUS
+EFIAPI
+UefiLvglGetInputLatency (
+  OUT LVGL_INPUT_LATENCY  *Latency,
+  IN  BOOLEAN             Reset
+  );
+
 #endif
\ No newline at end of file
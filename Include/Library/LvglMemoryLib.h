@@ -0,0 +1,71 @@
+/** @file
+  LvglMemoryLib class: memory of the LVGL UI accounted per subsystem, by
+  LvglLib and by the allocators outside of it, such as the one of FontLib.
+
+  Copyright (c) 2025, viZPilot. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __LVGL_MEMORY_LIB_H__
+#define __LVGL_MEMORY_LIB_H__
+
+///
+/// Subsystems whose memory is accounted separately, see LvglMemoryGetUsage.
+///
+typedef enum {
+  LvglMemoryObjects,        ///< LVGL objects, styles and anything else from lv_malloc.
+  LvglMemoryDisplay,        ///< Render, back and shadow buffers of the display.
+  LvglMemoryDrawBuffers,    ///< Decoded images and other image draw buffers.
+  LvglMemoryGlyphs,         ///< Glyph bitmaps.
+  LvglMemoryFreeType,       ///< FreeType faces and caches, charged by FontLib.
+  ///
+  /// Draw buffers of the default handlers created while a refresh renders:
+  /// its layers, but also a canvas or snapshot buffer a draw event creates,
+  /// which then keeps its chunk of the frame arena until it is freed.
+  ///
+  LvglMemoryFrame,
+  LvglMemoryTagMax
+} LVGL_MEMORY_TAG;
+
+typedef struct {
+  UINTN              CurrentBytes;
+  UINTN              PeakBytes;
+  UINT64             Allocations;     ///< Allocations and resizes.
+  UINT64             Frees;
+} LVGL_MEMORY_USAGE;
+
+/**
+  Account a block of a subsystem growing from Freed to Allocated bytes.
+  An allocation passes 0 for Freed, a free 0 for Allocated, and a resize
+  counts as an allocation.
+
+  @param[in]  Tag         Subsystem.
+  @param[in]  Freed       Bytes given back, the old size of a resized block.
+  @param[in]  Allocated   Bytes taken, the new size of a resized block.
+**/
+VOID
+EFIAPI
+LvglMemoryCharge (
+  IN LVGL_MEMORY_TAG      Tag,
+  IN UINTN                Freed,
+  IN UINTN                Allocated
+  );
+
+/**
+  Get the memory held by a subsystem, to size platform memory maps.
+
+  @param[in]  Tag       Subsystem.
+  @param[out] Usage     Bytes held now and at most, allocation counts.
+
+  @retval RETURN_SUCCESS            Usage was filled in.
+  @retval RETURN_INVALID_PARAMETER  Tag is out of range or Usage is NULL.
+**/
+RETURN_STATUS
+EFIAPI
+LvglMemoryGetUsage (
+  IN  LVGL_MEMORY_TAG     Tag,
+  OUT LVGL_MEMORY_USAGE   *Usage
+  );
+
+#endif
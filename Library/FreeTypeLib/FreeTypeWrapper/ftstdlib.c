@@ -7,6 +7,7 @@
 #include "ftdebug.h"
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/LvglMemoryLib.h>
 
 extern EFI_SYSTEM_TABLE  *gST;
 extern EFI_BOOT_SERVICES *gBS;
@@ -58,7 +59,8 @@ Edk2Calloc (size_t num, size_t size)
   if(Buffer == NULL) {
       return Buffer;
   }
-  Buffer[0] = size;
+  Buffer[0] = num*size;
+  LvglMemoryCharge (LvglMemoryFreeType, 0, num*size);
   return &Buffer[1];
 }
 
@@ -66,6 +68,7 @@ VOID
 Edk2Free (void *ptr)
 {
   UINT64 *Buffer = ptr;
+  LvglMemoryCharge (LvglMemoryFreeType, (UINTN)Buffer[-1], 0);
   FreePool((VOID*)(Buffer-1));
 }
 
@@ -79,6 +82,7 @@ Edk2Malloc (size_t size)
       return Buffer;
   }
   Buffer[0] = size;
+  LvglMemoryCharge (LvglMemoryFreeType, 0, size);
   return &Buffer[1];
 }
 
@@ -88,12 +92,15 @@ Edk2Realloc (void *ptr, size_t new_size)
   //The EDK2's Memory Allocation Library DO NOT cache the Memory size.
   //For this reason, we MUST load the cache from our own.
   UINT64 *Buffer = ptr;
+  UINTN  OldSize;
   Buffer --;
-  Buffer = ReallocatePool((UINTN)Buffer[0]+sizeof(UINT64),new_size+sizeof(UINT64),Buffer);
+  OldSize = (UINTN)Buffer[0];
+  Buffer = ReallocatePool(OldSize+sizeof(UINT64),new_size+sizeof(UINT64),Buffer);
   if(Buffer == NULL) {
       return Buffer;
   }
   Buffer[0] = new_size;
+  LvglMemoryCharge (LvglMemoryFreeType, OldSize, new_size);
   return &Buffer[1];
 }
 
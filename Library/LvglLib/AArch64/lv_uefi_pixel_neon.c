@@ -0,0 +1,99 @@
+/**
+ * @file lv_uefi_pixel_neon.c
+ *
+ * NEON variants of the framebuffer conversion and compare kernels.
+ *
+ * The build uses -nostdinc, so arm_neon.h is not available. The kernels are
+ * written with GCC/Clang vector types instead, which compile to plain NEON
+ * loads, shifts, masks and narrowing stores on AArch64.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "../lv_uefi_pixel.h"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef UINT32 v4u32 __attribute__((vector_size(16)));
+typedef UINT32 v4u32_u __attribute__((vector_size(16), aligned(4)));
+typedef UINT16 v4u16 __attribute__((vector_size(8)));
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void lv_uefi_pixel_rgbx8888_neon(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    UINTN head;
+    v4u32 p;
+
+    /*Framebuffers may be mapped as device memory: only store full, aligned vectors*/
+    head = ((16 - ((UINTN)dst & 15)) & 15) / sizeof(UINT32);
+    head = LV_MIN(head, count);
+    lv_uefi_pixel_rgbx8888_scalar(dst, src, head, fmt);
+    dst += head * sizeof(UINT32);
+    src += head;
+    count -= head;
+
+    while (count >= 4) {
+        p = *(const v4u32_u *)src;
+        *(v4u32 *)dst = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+        dst += 4 * sizeof(UINT32);
+        src += 4;
+        count -= 4;
+    }
+
+    lv_uefi_pixel_rgbx8888_scalar(dst, src, count, fmt);
+}
+
+void lv_uefi_pixel_rgb565_neon(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    UINTN head;
+    v4u32 p;
+
+    head = ((8 - ((UINTN)dst & 7)) & 7) / sizeof(UINT16);
+    head = LV_MIN(head, count);
+    lv_uefi_pixel_rgb565_scalar(dst, src, head, fmt);
+    dst += head * sizeof(UINT16);
+    src += head;
+    count -= head;
+
+    while (count >= 4) {
+        p = *(const v4u32_u *)src;
+        p = ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F);
+        *(v4u16 *)dst = __builtin_convertvector(p, v4u16);
+        dst += 4 * sizeof(UINT16);
+        src += 4;
+        count -= 4;
+    }
+
+    lv_uefi_pixel_rgb565_scalar(dst, src, count, fmt);
+}
+
+BOOLEAN lv_uefi_pixel_row_equal_neon(const UINT32 * a, const UINT32 * b, UINTN count)
+{
+    v4u32  diff;
+    UINT32 rest = 0;
+
+    while (count >= 16) {
+        diff = (*(const v4u32_u *)&a[0] ^ *(const v4u32_u *)&b[0]) |
+               (*(const v4u32_u *)&a[4] ^ *(const v4u32_u *)&b[4]) |
+               (*(const v4u32_u *)&a[8] ^ *(const v4u32_u *)&b[8]) |
+               (*(const v4u32_u *)&a[12] ^ *(const v4u32_u *)&b[12]);
+        if ((diff[0] | diff[1] | diff[2] | diff[3]) != 0) {
+            return FALSE;
+        }
+        a += 16;
+        b += 16;
+        count -= 16;
+    }
+
+    while (count--) {
+        rest |= *a++ ^ *b++;
+    }
+
+    return rest == 0;
+}
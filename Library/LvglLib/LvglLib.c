@@ -8,6 +8,85 @@ extern UINT8  mExitBtnYes;
 BOOLEAN  mTickSupport = FALSE;
 STATIC BOOLEAN  mUefiLvglInitDone = FALSE;
 
+//
+// Without a usable performance counter the LVGL tick is advanced by a
+// periodic timer event, at the usual 10 ms timer interrupt rate.
+//
+#define UEFI_LVGL_TICK_PERIOD_MS  10
+
+//
+// Main loop wait list: the LVGL timer event followed by the input devices.
+//
+#define UEFI_LVGL_MAX_WAIT_EVENTS 8
+
+//
+// Frame budget scheduler. A refresh is drawn whole, in one
+// lv_timer_handler() call; once it runs over the budget, the keyboard is
+// polled between its flushes, and the input is read right after it.
+//
+typedef struct {
+  UINT32      BudgetMs;                       // 0: scheduler off
+  UINT32      FrameStart;                     // lv_tick_get() at LV_EVENT_REFR_START
+  UINT32      PollTick;                       // lv_tick_get() at the last poll of the refresh
+  UINT64      FramePixels;                    // pixels flushed by the current refresh
+  UINT32      Frames;
+  UINT32      Overruns;
+  UINT32      Polls;                          // keyboard polls during refreshes
+  UINT32      WorstMs;
+} UEFI_LVGL_SCHED;
+
+STATIC UEFI_LVGL_SCHED  mSched;
+
+//
+// Refresh governor, see UefiLvglGovernorUpdate.
+//
+typedef struct {
+  lv_display_t        *Disp;
+  LVGL_REFRESH_MODE   Mode;
+  UINT32              DemandHz;
+  UINT32              TargetHz;
+  UINT32              ModeChanges;
+  UINT32              LastChange;                     // lv_tick_get() at the last mode change
+  BOOLEAN             Dirty;                          // areas invalidated since the last refresh
+} UEFI_LVGL_GOVERNOR;
+
+STATIC UEFI_LVGL_GOVERNOR  mGovernor;
+
+//
+// Input latency, see UefiLvglLatencyInput. Bucket b holds latencies up to
+// UefiLvglLatencyBucketTop (b) us, four buckets per power of two.
+//
+#define UEFI_LVGL_LATENCY_BUCKETS  128
+
+typedef struct {
+  UINT64      Pending;                        // counter at the oldest input not shown yet, 0: none
+  UINT32      Buckets[UEFI_LVGL_LATENCY_BUCKETS];
+  UINT32      Samples;
+  UINT32      Unshown;                        // inputs that changed nothing on the screen
+  UINT32      MaxUs;
+} UEFI_LVGL_LATENCY;
+
+STATIC UEFI_LVGL_LATENCY  mLatency;
+
+//
+// Input replay, see UefiLvglReplayLoop. The virtual tick advances by
+// UEFI_LVGL_REPLAY_TICK_MS per loop, and the loop keeps running for
+// UEFI_LVGL_REPLAY_TAIL_MS after the last record so that the animations
+// it started finish.
+//
+#define UEFI_LVGL_REPLAY_TICK_MS  5
+#define UEFI_LVGL_REPLAY_TAIL_MS  1000
+
+typedef struct {
+  uint32_t    Tick;                           // virtual LVGL tick
+  UINT64      FrameStart;                     // counter at LV_EVENT_REFR_START
+  UINT32      Frames;
+  UINT64      TotalUs;
+  UINT32      MaxUs;
+} UEFI_LVGL_REPLAY;
+
+STATIC UEFI_LVGL_REPLAY  mReplay;
+
 #if LV_USE_LOG
 static void efi_lv_log_print(lv_log_level_t level, const char * buf)
 {
@@ -20,20 +99,517 @@ static void efi_lv_log_print(lv_log_level_t level, const char * buf)
 #endif
 
 
+//
+// Performance counter -> millisecond conversion, set up by UefiLvglTickInit.
+// ms = ticks * mTickMult >> (32 + mTickShift), mTickMult < 2^32.
+//
+STATIC UINT64   mTickStart;
+STATIC UINT64   mTickEnd;
+STATIC UINT64   mTickLast;
+STATIC UINT64   mTickElapsed;
+STATIC UINT32   mTickMult;
+STATIC UINTN    mTickShift;
+STATIC UINT64   mTickFreq;
+
+
+/**
+  LVGL tick callback: milliseconds since UefiLvglTickInit.
+
+  The counter may count down or be narrower than 64 bits, so elapsed
+  ticks are accumulated from the last reading. The conversion is two
+  32 x 32 bit multiplies and a shift, no division.
+
+  The input timers read the tick too, so the accumulation runs at
+  TPL_HIGH_LEVEL, or an interval would be counted twice.
+**/
 static uint32_t tick_get_cb(void)
 {
-  return (UINT32) DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter()), 1000 * 1000);
+  EFI_TPL  OldTpl;
+  UINT64   Now;
+  UINT64   Delta;
+  UINT64   Elapsed;
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  Now = GetPerformanceCounter ();
+  if (mTickEnd > mTickStart) {
+    Delta = Now >= mTickLast ? Now - mTickLast : (mTickEnd - mTickLast) + (Now - mTickStart) + 1;
+  } else {
+    Delta = Now <= mTickLast ? mTickLast - Now : (mTickLast - mTickEnd) + (mTickStart - Now) + 1;
+  }
+  mTickLast = Now;
+  mTickElapsed += Delta;
+  Elapsed = mTickElapsed;
+  gBS->RestoreTPL (OldTpl);
+
+  //
+  // (Elapsed * Mult) >> 32 computed exactly from the two 32 bit halves of
+  // Elapsed, then the remaining shift.
+  //
+  return (UINT32)RShiftU64 (
+                   MultU64x32 (RShiftU64 (Elapsed, 32), mTickMult) +
+                   RShiftU64 (MultU64x32 (Elapsed & 0xFFFFFFFF, mTickMult), 32),
+                   mTickShift
+                   );
 }
 
+/**
+  LVGL tick callback while input is replayed: the virtual tick the replay
+  loop advances, independent of how long rendering takes.
+**/
+static uint32_t UefiLvglReplayTickCb(void)
+{
+  return mReplay.Tick;
+}
+
+/**
+  Use the TimerLib performance counter (the ARM generic timer on AArch64)
+  as LVGL's millisecond tick.
+
+  The frequency TimerLib reports is checked against a 10 ms Stall, which
+  also stands in when the counter frequency is not programmed. Without a
+  running counter the tick stays on the periodic timer event of the main
+  loop.
+**/
 VOID
 EFIAPI
 UefiLvglTickInit (
   VOID
   )
 {
-  if (GetPerformanceCounter()) {
-    mTickSupport = TRUE;
-    lv_tick_set_cb(tick_get_cb);
+  UINT64  Freq;
+  UINT64  Measured;
+  UINT64  Before;
+  UINT64  After;
+  BOOLEAN Wrapped;
+  UINTN   Shift;
+
+  Freq = GetPerformanceCounterProperties (&mTickStart, &mTickEnd);
+
+  Before = GetPerformanceCounter ();
+  gBS->Stall (10 * 1000);
+  After = GetPerformanceCounter ();
+
+  if (Before == After) {
+    DebugPrint (DEBUG_WARN, "LVGL: performance counter not running, using the timer event tick\n");
+    return;
+  }
+
+  //
+  // A narrow counter may wrap during the Stall, which makes the measurement
+  // meaningless. Otherwise prefer it over a frequency off by more than 10%.
+  //
+  Wrapped = mTickEnd > mTickStart ? After < Before : After > Before;
+  if (!Wrapped) {
+    Measured = MultU64x32 (mTickEnd > mTickStart ? After - Before : Before - After, 100);
+    if (Freq == 0 || Measured < Freq - Freq / 10 || Measured > Freq + Freq / 10) {
+      DebugPrint (DEBUG_WARN, "LVGL: counter frequency %ld Hz, measured %ld Hz\n", Freq, Measured);
+      Freq = Measured;
+    }
+  }
+
+  if (Freq < 1000) {
+    return;
+  }
+
+  //
+  // Largest shift that keeps the 1000 / Freq multiplier below 2^32, for the
+  // best precision. 1000 < 2^10 bounds it to 22. The multiplier is rounded
+  // up so that whole seconds do not come out a millisecond short.
+  //
+  for (Shift = 22; Shift > 0; Shift--) {
+    if (DivU64x64Remainder (LShiftU64 (1000, 32 + Shift) + Freq - 1, Freq, NULL) <= MAX_UINT32) {
+      break;
+    }
+  }
+  mTickShift = Shift;
+  mTickMult  = (UINT32)DivU64x64Remainder (LShiftU64 (1000, 32 + Shift) + Freq - 1, Freq, NULL);
+  mTickFreq  = Freq;
+
+  mTickLast = GetPerformanceCounter ();
+  mTickElapsed = 0;
+
+  DebugPrint (DEBUG_INFO, "LVGL: tick from a %ld Hz counter\n", Freq);
+
+  mTickSupport = TRUE;
+  lv_tick_set_cb (tick_get_cb);
+}
+
+
+/**
+  Counter ticks from Older to Newer, for a counter counting either way.
+**/
+STATIC
+UINT64
+UefiLvglCounterDelta (
+  IN UINT64  Older,
+  IN UINT64  Newer
+  )
+{
+  if (mTickEnd > mTickStart) {
+    return Newer >= Older ? Newer - Older : (mTickEnd - Older) + (Newer - mTickStart) + 1;
+  }
+
+  return Newer <= Older ? Older - Newer : (Older - mTickEnd) + (mTickStart - Newer) + 1;
+}
+
+
+STATIC
+UINT32
+UefiLvglLatencyBucket (
+  IN UINT32  Us
+  )
+{
+  UINT32  Exp;
+
+  if (Us < 4) {
+    return Us;
+  }
+
+  Exp = (UINT32)HighBitSet32 (Us);
+  return LV_MIN ((Exp - 1) * 4 + ((Us >> (Exp - 2)) & 3), UEFI_LVGL_LATENCY_BUCKETS - 1);
+}
+
+
+STATIC
+UINT32
+UefiLvglLatencyBucketTop (
+  IN UINT32  Bucket
+  )
+{
+  UINT64  Top;
+
+  if (Bucket < 4) {
+    return Bucket;
+  }
+
+  Top = LShiftU64 (4 + Bucket % 4 + 1, Bucket / 4 - 1) - 1;
+  return (UINT32)LV_MIN (Top, mLatency.MaxUs);
+}
+
+
+/**
+  Note that LVGL was handed new input.
+
+  The input devices pass the performance counter value at which the
+  firmware returned the data. Only the oldest input not shown yet is
+  kept: everything LVGL got since shows up in the same flush.
+**/
+VOID
+UefiLvglLatencyInput (
+  IN UINT64  Stamp
+  )
+{
+  if (mTickSupport && mLatency.Pending == 0) {
+    mLatency.Pending = Stamp;
+  }
+}
+
+
+/**
+  Note that the last area of a refresh, or the moved cursor, reached the
+  screen, and account the pending input against it.
+**/
+VOID
+UefiLvglLatencyShown (
+  VOID
+  )
+{
+  UINT64  Us;
+
+  if (mLatency.Pending == 0) {
+    return;
+  }
+
+  Us = DivU64x64Remainder (MultU64x32 (UefiLvglCounterDelta (mLatency.Pending, GetPerformanceCounter ()), 1000000),
+                           mTickFreq, NULL);
+  Us = LV_MIN (Us, MAX_UINT32);
+  mLatency.Pending = 0;
+  mLatency.Samples++;
+  mLatency.MaxUs = LV_MAX (mLatency.MaxUs, (UINT32)Us);
+  mLatency.Buckets[UefiLvglLatencyBucket ((UINT32)Us)]++;
+}
+
+
+/**
+  Drop the pending input when LVGL has nothing left to draw: it changed
+  nothing on the screen, and the next flush belongs to something else.
+**/
+STATIC
+VOID
+UefiLvglLatencySettle (
+  IN lv_display_t  *Disp
+  )
+{
+  if (mLatency.Pending != 0 && Disp != NULL && !mGovernor.Dirty) {
+    mLatency.Pending = 0;
+    mLatency.Unshown++;
+  }
+}
+
+
+/**
+  Smallest bucket top at or below which Percent percent of the samples lie.
+**/
+STATIC
+UINT32
+UefiLvglLatencyPercentile (
+  IN UINT32  Percent
+  )
+{
+  UINT32  Rank;
+  UINT32  Seen;
+  UINT32  Bucket;
+
+  if (mLatency.Samples == 0) {
+    return 0;
+  }
+
+  Rank = (UINT32)DivU64x32 (MultU64x32 (mLatency.Samples, Percent) + 99, 100);
+  Seen = 0;
+  for (Bucket = 0; Bucket < UEFI_LVGL_LATENCY_BUCKETS; Bucket++) {
+    Seen += mLatency.Buckets[Bucket];
+    if (Seen >= Rank) {
+      return UefiLvglLatencyBucketTop (Bucket);
+    }
+  }
+
+  return mLatency.MaxUs;
+}
+
+
+STATIC
+VOID
+UefiLvglLatencyReport (
+  VOID
+  )
+{
+  DebugPrint (DEBUG_INFO, "LVGL: input to flush latency over %d inputs (%d showed nothing): p50 %d us, p95 %d us, p99 %d us, max %d us\n",
+              mLatency.Samples, mLatency.Unshown, UefiLvglLatencyPercentile (50), UefiLvglLatencyPercentile (95),
+              UefiLvglLatencyPercentile (99), mLatency.MaxUs);
+}
+
+
+/**
+  Get the latency from input data returned by the firmware (ReadKeyStrokeEx,
+  pointer GetState) to the first flush that puts its result on the screen.
+  Percentiles are accurate to a quarter of their power of two.
+
+  @param[out] Latency   Sample count and percentiles.
+  @param[in]  Reset     Start a new measurement after reading this one.
+
+  @retval EFI_SUCCESS            Latency was filled in.
+  @retval EFI_INVALID_PARAMETER  Latency is NULL.
+  @retval EFI_UNSUPPORTED        No performance counter to measure with.
+**/
+EFI_STATUS
+EFIAPI
+UefiLvglGetInputLatency (
+  OUT LVGL_INPUT_LATENCY  *Latency,
+  IN  BOOLEAN             Reset
+  )
+{
+  if (Latency == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (!mTickSupport) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Latency->Samples = mLatency.Samples;
+  Latency->Unshown = mLatency.Unshown;
+  Latency->P50Us = UefiLvglLatencyPercentile (50);
+  Latency->P95Us = UefiLvglLatencyPercentile (95);
+  Latency->P99Us = UefiLvglLatencyPercentile (99);
+  Latency->MaxUs = mLatency.MaxUs;
+
+  if (Reset) {
+    ZeroMem (&mLatency, sizeof (mLatency));
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+STATIC_ASSERT (LvglMemoryObjects == LVGL_UEFI_HEAP_OBJECTS, "malloc does not allocate as LvglMemoryObjects");
+STATIC_ASSERT (LvglMemoryFrame == LVGL_UEFI_HEAP_FRAME, "LVGL_MEMORY_TAG does not match the port heap");
+
+STATIC CONST CHAR8  *mMemoryTagName[LvglMemoryTagMax] = {
+  "objects", "display", "draw buffers", "glyphs", "FreeType", "layers"
+};
+
+//
+// Draw buffers come from their own handlers so that they are told apart
+// from LVGL objects. Like LVGL's handlers, they leave room to align the
+// buffer to LV_DRAW_BUF_ALIGN. Only the default handlers, which LVGL
+// creates its layers with, may use the frame arena, and only while the
+// areas of a refresh are rendered: decoded images and glyphs are cached
+// beyond the frame.
+//
+STATIC
+VOID *
+UefiLvglLayerBufMallocCb (
+  IN size_t             Size,
+  IN lv_color_format_t  ColorFormat
+  )
+{
+  return LvglUefiHeapAlloc (LvglMemoryFrame, Size + LV_DRAW_BUF_ALIGN - 1);
+}
+
+STATIC
+VOID
+UefiLvglLayerBufFreeCb (
+  IN VOID  *Buf
+  )
+{
+  LvglUefiHeapFree (LvglMemoryFrame, Buf);
+}
+
+STATIC
+VOID *
+UefiLvglDrawBufMallocCb (
+  IN size_t             Size,
+  IN lv_color_format_t  ColorFormat
+  )
+{
+  return LvglUefiHeapAlloc (LvglMemoryDrawBuffers, Size + LV_DRAW_BUF_ALIGN - 1);
+}
+
+STATIC
+VOID
+UefiLvglDrawBufFreeCb (
+  IN VOID  *Buf
+  )
+{
+  LvglUefiHeapFree (LvglMemoryDrawBuffers, Buf);
+}
+
+STATIC
+VOID *
+UefiLvglGlyphBufMallocCb (
+  IN size_t             Size,
+  IN lv_color_format_t  ColorFormat
+  )
+{
+  return LvglUefiHeapAlloc (LvglMemoryGlyphs, Size + LV_DRAW_BUF_ALIGN - 1);
+}
+
+STATIC
+VOID
+UefiLvglGlyphBufFreeCb (
+  IN VOID  *Buf
+  )
+{
+  LvglUefiHeapFree (LvglMemoryGlyphs, Buf);
+}
+
+//
+// The alignment and stride LVGL's own handlers use, which lv_draw_buf.h
+// does not export.
+//
+STATIC
+VOID *
+UefiLvglDrawBufAlignCb (
+  IN VOID               *Buf,
+  IN lv_color_format_t  ColorFormat
+  )
+{
+  return (VOID *)LV_ROUND_UP ((lv_uintptr_t)Buf, LV_DRAW_BUF_ALIGN);
+}
+
+STATIC
+UINT32
+UefiLvglDrawBufStrideCb (
+  IN UINT32             Width,
+  IN lv_color_format_t  ColorFormat
+  )
+{
+  return LV_ROUND_UP ((Width * lv_color_format_get_bpp (ColorFormat) + 7) >> 3, LV_DRAW_BUF_STRIDE_ALIGN);
+}
+
+
+/**
+  Route the draw buffers of layers, images and glyphs to their tags.
+  Must run before anything creates a draw buffer, right after lv_init.
+  The software renderer needs no cache maintenance callbacks.
+**/
+STATIC
+VOID
+UefiLvglMemoryInit (
+  VOID
+  )
+{
+  lv_draw_buf_handlers_init (lv_draw_buf_get_handlers (), UefiLvglLayerBufMallocCb, UefiLvglLayerBufFreeCb,
+                             UefiLvglDrawBufAlignCb, NULL, NULL, UefiLvglDrawBufStrideCb);
+  lv_draw_buf_handlers_init (lv_draw_buf_get_image_handlers (), UefiLvglDrawBufMallocCb, UefiLvglDrawBufFreeCb,
+                             UefiLvglDrawBufAlignCb, NULL, NULL, UefiLvglDrawBufStrideCb);
+  lv_draw_buf_handlers_init (lv_draw_buf_get_font_handlers (), UefiLvglGlyphBufMallocCb, UefiLvglGlyphBufFreeCb,
+                             UefiLvglDrawBufAlignCb, NULL, NULL, UefiLvglDrawBufStrideCb);
+}
+
+
+STATIC
+VOID
+UefiLvglFrameEvtCb (
+  IN lv_event_t  *e
+  )
+{
+  if (lv_event_get_code (e) == LV_EVENT_RENDER_START) {
+    LvglUefiHeapFrameBegin ();
+  } else {
+    LvglUefiHeapFrameEnd ();
+  }
+}
+
+
+/**
+  Serve the layers of every refresh from the frame arena of the port heap.
+  The frame starts at LV_EVENT_RENDER_START, after the layout update and
+  the LV_EVENT_REFR_START callbacks, whose buffers outlive the frame.
+  A draw buffer of the default handlers an event creates while the areas
+  are rendered, such as a canvas or snapshot, still lands in the arena and
+  keeps its chunk until it is freed.
+**/
+STATIC
+VOID
+UefiLvglFrameInit (
+  IN lv_display_t  *Disp
+  )
+{
+  if (Disp == NULL || FixedPcdGet16 (PcdLvglHeapFramePages) == 0) {
+    return;
+  }
+
+  lv_display_add_event_cb (Disp, UefiLvglFrameEvtCb, LV_EVENT_RENDER_START, NULL);
+  lv_display_add_event_cb (Disp, UefiLvglFrameEvtCb, LV_EVENT_RENDER_READY, NULL);
+}
+
+
+/**
+  Log the high water mark of every subsystem. Run after lv_deinit, so
+  that the bytes still allocated are what LVGL or its users leaked.
+**/
+STATIC
+VOID
+UefiLvglMemoryReport (
+  VOID
+  )
+{
+  LVGL_UEFI_HEAP_STATS  Heap;
+  LVGL_MEMORY_USAGE     Usage;
+  UINT32                Tag;
+
+  for (Tag = 0; Tag < LvglMemoryTagMax; Tag++) {
+    if (!RETURN_ERROR (LvglMemoryGetUsage ((LVGL_MEMORY_TAG)Tag, &Usage)) && Usage.Allocations != 0) {
+      DebugPrint (DEBUG_INFO, "LVGL memory: %a: peak %ld bytes, %ld allocations, %ld frees, %ld bytes still allocated\n",
+                  mMemoryTagName[Tag], (UINT64)Usage.PeakBytes, Usage.Allocations, Usage.Frees,
+                  (UINT64)Usage.CurrentBytes);
+    }
+  }
+
+  LvglUefiHeapGetStats (&Heap);
+  if (Heap.Frames != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL memory: frame arena: %ld blocks, %d chunks (peak %d), %d of %d frames without a pool allocation\n",
+                Heap.FrameAllocs, Heap.FrameChunks, Heap.FrameChunksPeak, Heap.FramesNoPool, Heap.Frames);
   }
 }
 
@@ -45,35 +621,80 @@ UefiLvglInit (
   )
 {
   EFI_GRAPHICS_OUTPUT_PROTOCOL       *GraphicsOutput;
-  EFI_STATUS                         Status;
-  UINTN                              Width, Heigth;
+  UINTN                              Width, Heigth, Swap;
+  lv_uefi_disp_config_t              DispConfig;
 
   if (mUefiLvglInitDone) {
     return EFI_SUCCESS;
   }
 
-  Status = gBS->LocateProtocol (&gEfiGraphicsOutputProtocolGuid, NULL, (VOID **) &GraphicsOutput);
-  if (EFI_ERROR(Status)) {
+  //
+  // The UI is sized for the primary output and mirrored to the others.
+  //
+  if (lv_uefi_disp_locate_outputs (&GraphicsOutput, 1) == 0) {
     return EFI_UNSUPPORTED;
   }
 
   lv_init();
+  UefiLvglMemoryInit ();
 
-#if 0
-  // Need real TimerLib
-  UefiLvglTickInit();
-#endif
+  UefiLvglTickInit ();
+  ZeroMem (&mLatency, sizeof (mLatency));
+
+  //
+  // A replay runs on the virtual tick from the start, so that the input
+  // log lines up with the same LVGL timers on every run.
+  //
+  ZeroMem (&mReplay, sizeof (mReplay));
+  if (FixedPcdGet8 (PcdLvglInputMode) == LVGL_INPUT_REPLAY) {
+    mReplay.Tick = lv_tick_get ();
+    lv_tick_set_cb (UefiLvglReplayTickCb);
+  }
 
 #if LV_USE_LOG
   lv_log_register_print_cb (efi_lv_log_print);
 #endif
 
+  //
+  // LVGL may render at a fraction of the GOP mode, the display upscales
+  // every flushed area to the native resolution.
+  //
   Width  = GraphicsOutput->Mode->Info->HorizontalResolution;
   Heigth = GraphicsOutput->Mode->Info->VerticalResolution;
+  if (FixedPcdGet8 (PcdLvglRenderScaleNum) != 0 &&
+      FixedPcdGet8 (PcdLvglRenderScaleNum) < FixedPcdGet8 (PcdLvglRenderScaleDen)) {
+    Width  = Width * FixedPcdGet8 (PcdLvglRenderScaleNum) / FixedPcdGet8 (PcdLvglRenderScaleDen);
+    Heigth = Heigth * FixedPcdGet8 (PcdLvglRenderScaleNum) / FixedPcdGet8 (PcdLvglRenderScaleDen);
+  }
+
+  DispConfig.backend      = (lv_uefi_disp_backend_t)FixedPcdGet8 (PcdLvglDisplayBackend);
+  DispConfig.render_mode  = FixedPcdGet8 (PcdLvglDisplayRenderMode) == 1 ?
+                            LV_DISPLAY_RENDER_MODE_PARTIAL : LV_DISPLAY_RENDER_MODE_DIRECT;
+  DispConfig.band_divisor = FixedPcdGet8 (PcdLvglDisplayBandDivisor);
+  DispConfig.band_count   = FixedPcdGet8 (PcdLvglDisplayBandCount);
+  DispConfig.merge_slack  = FixedPcdGet32 (PcdLvglDisplayMergeSlack);
+  DispConfig.tile_diff    = FixedPcdGetBool (PcdLvglDisplayTileDiff);
+  DispConfig.rotation     = (lv_display_rotation_t)((FixedPcdGet16 (PcdLvglDisplayRotation) / 90) % 4);
+
+  //
+  // A UI rotated by 90 or 270 degrees is as wide as the panel is high.
+  //
+  if (DispConfig.rotation == LV_DISPLAY_ROTATION_90 || DispConfig.rotation == LV_DISPLAY_ROTATION_270) {
+    Swap = Width;
+    Width = Heigth;
+    Heigth = Swap;
+  }
 
-  lv_disp_t *display = lv_uefi_disp_create (Width, Heigth);
+  lv_disp_t *display = lv_uefi_disp_create (Width, Heigth, &DispConfig);
 
   lv_port_indev_init(display);
+  if (FixedPcdGet8 (PcdLvglInputMode) == LVGL_INPUT_REPLAY && !lv_port_indev_replaying ()) {
+    lv_tick_set_cb (mTickSupport ? tick_get_cb : NULL);
+  }
+
+  UefiLvglSchedInit (display);
+  UefiLvglGovernorInit (display);
+  UefiLvglFrameInit (display);
 
   mUefiLvglInitDone = TRUE;
 
@@ -93,10 +714,19 @@ UefiLvglDeinit (
 
   LvglUefiEscExitUnregister ();
 
-  lv_deinit();
+  if (FixedPcdGetBool (PcdLvglLatencyReport)) {
+    UefiLvglLatencyReport ();
+  }
 
+  //
+  // Stops the pointer sampling timer, whose context is an LVGL input device.
+  //
   lv_port_indev_close();
 
+  lv_deinit();
+  LvglUefiHeapTrim ();
+  UefiLvglMemoryReport ();
+
   gST->ConOut->ClearScreen (gST->ConOut);
   gST->ConOut->SetCursorPosition (gST->ConOut, 0, 0);
   gST->ConOut->EnableCursor (gST->ConOut, TRUE);
@@ -106,6 +736,579 @@ UefiLvglDeinit (
   return EFI_SUCCESS;
 }
 
+STATIC
+VOID
+EFIAPI
+UefiLvglTickNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  lv_tick_inc (UEFI_LVGL_TICK_PERIOD_MS);
+}
+
+
+/**
+  Account a finished refresh against the budget. Called at
+  LV_EVENT_REFR_READY.
+
+  A refresh is always drawn whole: cutting it between areas would show
+  related areas from different frames. After one over the budget, the
+  input read timers are made ready so that lv_timer_handler reads the
+  devices right after it, instead of a further read period later. What
+  UefiLvglSchedPoll queued in the meantime is handed to LVGL then.
+**/
+STATIC
+VOID
+UefiLvglSchedRefrReady (
+  IN lv_display_t  *Disp
+  )
+{
+  UINT32      Elapsed;
+  lv_indev_t  *Indev;
+  lv_timer_t  *Timer;
+
+  if (mSched.FramePixels == 0) {
+    return;
+  }
+
+  Elapsed = lv_tick_elaps (mSched.FrameStart);
+  mSched.Frames++;
+  mSched.WorstMs = LV_MAX (mSched.WorstMs, Elapsed);
+  if (Elapsed <= mSched.BudgetMs) {
+    return;
+  }
+
+  mSched.Overruns++;
+  DebugPrint (DEBUG_VERBOSE, "LVGL: frame %d took %d ms for %ld pixels, budget %d ms\n",
+              mSched.Frames, Elapsed, mSched.FramePixels, mSched.BudgetMs);
+
+  for (Indev = lv_indev_get_next (NULL); Indev != NULL; Indev = lv_indev_get_next (Indev)) {
+    Timer = lv_indev_get_read_timer (Indev);
+    if (Timer != NULL) {
+      lv_timer_ready (Timer);
+    }
+  }
+}
+
+
+/**
+  Poll the keyboard from a refresh that runs over the budget, once per
+  budget. Called at LV_EVENT_FLUSH_FINISH, between the bands or areas of
+  the refresh.
+
+  LVGL cannot process input before the refresh is over, but the keystrokes
+  are moved into the port queue with the time they arrived, so they do
+  not wait in, or overflow, the firmware buffer. Pointer samples are taken
+  by the sampling timer of the port in the meantime.
+**/
+STATIC
+VOID
+UefiLvglSchedPoll (
+  VOID
+  )
+{
+  if (lv_tick_elaps (mSched.PollTick) < mSched.BudgetMs) {
+    return;
+  }
+
+  mSched.PollTick = lv_tick_get ();
+  mSched.Polls++;
+  lv_port_indev_poll ();
+}
+
+
+STATIC
+VOID
+UefiLvglSchedEvtCb (
+  IN lv_event_t  *e
+  )
+{
+  lv_display_t  *Disp = lv_event_get_target (e);
+  lv_area_t     *Area;
+
+  switch (lv_event_get_code (e)) {
+    case LV_EVENT_REFR_START:
+      mSched.FrameStart = lv_tick_get ();
+      mSched.PollTick = mSched.FrameStart;
+      mSched.FramePixels = 0;
+      break;
+
+    case LV_EVENT_FLUSH_START:
+      Area = lv_event_get_param (e);
+      if (Area != NULL) {
+        mSched.FramePixels += lv_area_get_size (Area);
+      }
+      break;
+
+    case LV_EVENT_FLUSH_FINISH:
+      UefiLvglSchedPoll ();
+      break;
+
+    case LV_EVENT_REFR_READY:
+      UefiLvglSchedRefrReady (Disp);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/**
+  Measure refreshes against PcdLvglFrameBudgetMs, poll the keyboard during
+  those over it and read input right after them. Needs the counter based
+  tick.
+**/
+STATIC
+VOID
+UefiLvglSchedInit (
+  IN lv_display_t  *Disp
+  )
+{
+  ZeroMem (&mSched, sizeof (mSched));
+  mSched.BudgetMs = FixedPcdGet8 (PcdLvglFrameBudgetMs);
+  if (Disp == NULL || mSched.BudgetMs == 0 || !mTickSupport) {
+    mSched.BudgetMs = 0;
+    return;
+  }
+
+  lv_display_add_event_cb (Disp, UefiLvglSchedEvtCb, LV_EVENT_REFR_START, NULL);
+  lv_display_add_event_cb (Disp, UefiLvglSchedEvtCb, LV_EVENT_FLUSH_START, NULL);
+  lv_display_add_event_cb (Disp, UefiLvglSchedEvtCb, LV_EVENT_FLUSH_FINISH, NULL);
+  lv_display_add_event_cb (Disp, UefiLvglSchedEvtCb, LV_EVENT_REFR_READY, NULL);
+}
+
+
+/**
+  Set the period of the refresh, animation and input read timers, or pause
+  the input timers when Hz is 0.
+**/
+STATIC
+VOID
+UefiLvglSetRefreshRate (
+  IN UINT32  Hz
+  )
+{
+  lv_indev_t  *Indev;
+  UINT32      Period;
+
+  Period = Hz != 0 ? 1000 / Hz : 0;
+  if (Period != 0) {
+    lv_timer_set_period (lv_display_get_refr_timer (mGovernor.Disp), Period);
+    lv_timer_set_period (lv_anim_get_timer (), Period);
+  }
+
+  for (Indev = lv_indev_get_next (NULL); Indev != NULL; Indev = lv_indev_get_next (Indev)) {
+    if (Period == 0) {
+      lv_timer_pause (lv_indev_get_read_timer (Indev));
+    } else {
+      lv_timer_set_period (lv_indev_get_read_timer (Indev), Period);
+      lv_timer_resume (lv_indev_get_read_timer (Indev));
+    }
+  }
+}
+
+
+/**
+  Pick the refresh mode from what LVGL is doing.
+
+  Animated: animations are running or an input device is scrolling (also
+  while a scroll throws out), refresh at PcdLvglRefreshTargetHz.
+  On demand: something is invalidated or pressed, refresh right after the
+  first invalidation, then refresh and read input at PcdLvglRefreshDemandHz.
+  Idle: nothing to draw and nothing pressed. LVGL pauses its refresh timer
+  by itself, the input read timers are paused too, and the main loop
+  sleeps until an input event or an application timer wakes it.
+
+  @retval TRUE    The mode changed, timer periods were updated.
+**/
+STATIC
+BOOLEAN
+UefiLvglGovernorUpdate (
+  VOID
+  )
+{
+  LVGL_REFRESH_MODE   Mode;
+  lv_indev_t          *Indev;
+  BOOLEAN             Scrolling;
+  BOOLEAN             Pressed;
+
+  if (mGovernor.Disp == NULL) {
+    return FALSE;
+  }
+
+  Scrolling = FALSE;
+  Pressed = FALSE;
+  for (Indev = lv_indev_get_next (NULL); Indev != NULL; Indev = lv_indev_get_next (Indev)) {
+    Scrolling |= lv_indev_get_scroll_obj (Indev) != NULL;
+    Pressed |= lv_indev_get_state (Indev) == LV_INDEV_STATE_PRESSED;
+  }
+
+  if (lv_anim_count_running () != 0 || Scrolling) {
+    Mode = LvglRefreshAnimated;
+  } else if (mGovernor.Dirty || Pressed) {
+    Mode = LvglRefreshOnDemand;
+  } else {
+    Mode = LvglRefreshIdle;
+  }
+
+  if (Mode == mGovernor.Mode) {
+    return FALSE;
+  }
+
+  DebugPrint (DEBUG_VERBOSE, "LVGL: refresh mode %d -> %d after %d ms\n",
+              mGovernor.Mode, Mode, lv_tick_elaps (mGovernor.LastChange));
+
+  mGovernor.Mode = Mode;
+  mGovernor.ModeChanges++;
+  mGovernor.LastChange = lv_tick_get ();
+  UefiLvglSetRefreshRate (Mode == LvglRefreshAnimated ? mGovernor.TargetHz :
+                          Mode == LvglRefreshOnDemand ? mGovernor.DemandHz : 0);
+
+  return TRUE;
+}
+
+
+/**
+  Track whether the display has areas to redraw, which LVGL only keeps in
+  its private display state.
+
+  The first invalidation after a refresh makes the refresh timer ready,
+  so the change is drawn on the next lv_timer_handler() instead of up to
+  a demand period later. Animations keep the pace of the target rate.
+**/
+STATIC
+VOID
+UefiLvglGovernorEvtCb (
+  IN lv_event_t  *e
+  )
+{
+  if (lv_event_get_code (e) != LV_EVENT_INVALIDATE_AREA) {
+    mGovernor.Dirty = FALSE;
+    return;
+  }
+
+  if (!mGovernor.Dirty && mGovernor.Mode != LvglRefreshAnimated) {
+    lv_timer_ready (lv_display_get_refr_timer (mGovernor.Disp));
+  }
+  mGovernor.Dirty = TRUE;
+}
+
+
+STATIC
+VOID
+UefiLvglGovernorInit (
+  IN lv_display_t  *Disp
+  )
+{
+  ZeroMem (&mGovernor, sizeof (mGovernor));
+  if (Disp == NULL) {
+    return;
+  }
+
+  mGovernor.Disp = Disp;
+  lv_display_add_event_cb (Disp, UefiLvglGovernorEvtCb, LV_EVENT_INVALIDATE_AREA, NULL);
+  lv_display_add_event_cb (Disp, UefiLvglGovernorEvtCb, LV_EVENT_REFR_READY, NULL);
+  mGovernor.TargetHz = LV_CLAMP (1, FixedPcdGet16 (PcdLvglRefreshTargetHz), 1000);
+  mGovernor.DemandHz = LV_CLAMP (1, FixedPcdGet16 (PcdLvglRefreshDemandHz), 1000);
+  mGovernor.Mode = LvglRefreshOnDemand;
+  mGovernor.LastChange = lv_tick_get ();
+  UefiLvglSetRefreshRate (mGovernor.DemandHz);
+}
+
+
+/**
+  Get the refresh mode the governor picked and the rate it runs at.
+
+  @param[out] State   Current mode, rate and number of mode changes.
+
+  @retval EFI_SUCCESS            State was filled in.
+  @retval EFI_INVALID_PARAMETER  State is NULL.
+  @retval EFI_NOT_READY          LVGL is not initialized.
+**/
+EFI_STATUS
+EFIAPI
+UefiLvglGetRefreshState (
+  OUT LVGL_REFRESH_STATE  *State
+  )
+{
+  if (State == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (!mUefiLvglInitDone || mGovernor.Disp == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  State->Mode = mGovernor.Mode;
+  State->RateHz = mGovernor.Mode == LvglRefreshAnimated ? mGovernor.TargetHz :
+                  mGovernor.Mode == LvglRefreshOnDemand ? mGovernor.DemandHz : 0;
+  State->ModeChanges = mGovernor.ModeChanges;
+  State->MsInMode = lv_tick_elaps (mGovernor.LastChange);
+
+  return EFI_SUCCESS;
+}
+
+
+STATIC
+VOID
+UefiLvglReplayEvtCb (
+  IN lv_event_t  *e
+  )
+{
+  UINT64                Us;
+  LVGL_UEFI_HEAP_STATS  Heap;
+
+  if (!mTickSupport) {
+    return;
+  }
+
+  if (lv_event_get_code (e) == LV_EVENT_REFR_START) {
+    mReplay.FrameStart = GetPerformanceCounter ();
+    return;
+  }
+
+  Us = DivU64x64Remainder (MultU64x32 (UefiLvglCounterDelta (mReplay.FrameStart, GetPerformanceCounter ()), 1000000),
+                           mTickFreq, NULL);
+  Us = LV_MIN (Us, MAX_UINT32);
+  mReplay.Frames++;
+  mReplay.TotalUs += Us;
+  mReplay.MaxUs = LV_MAX (mReplay.MaxUs, (UINT32)Us);
+  //
+  // The frame arena ended the frame at LV_EVENT_RENDER_READY, before this.
+  //
+  LvglUefiHeapGetStats (&Heap);
+  if (Heap.Frames != 0) {
+    DebugPrint (DEBUG_VERBOSE, "LVGL replay: frame %d at %d ms: %d us, %d pool allocations\n", mReplay.Frames, mReplay.Tick,
+                (UINT32)Us, Heap.FramePoolAllocs);
+  } else {
+    DebugPrint (DEBUG_VERBOSE, "LVGL replay: frame %d at %d ms: %d us\n", mReplay.Frames, mReplay.Tick, (UINT32)Us);
+  }
+}
+
+
+/**
+  Average nanoseconds of Calls calls that took Ticks counter ticks. A
+  single call is often shorter than a tick, so the total is converted
+  first.
+**/
+STATIC
+UINT64
+UefiLvglTicksPerCall (
+  IN UINT64  Ticks,
+  IN UINT64  Calls
+  )
+{
+  return DivU64x64Remainder (MultU64x32 (DivU64x64Remainder (MultU64x32 (Ticks, 1000000), mTickFreq, NULL), 1000),
+                             Calls, NULL);
+}
+
+
+/**
+  Run LVGL on the recorded input, for benchmarks.
+
+  The loop never sleeps: every pass runs the LVGL timers, reads every input
+  device and then advances the virtual tick by UEFI_LVGL_REPLAY_TICK_MS, so
+  a replay renders the same frames at the same ticks on every run however
+  long they take. The real time of every frame is logged, followed by a
+  summary with the heap high water mark.
+**/
+STATIC
+VOID
+UefiLvglReplayLoop (
+  VOID
+  )
+{
+  lv_indev_t                         *Indev;
+  BOOLEAN                            Done;
+  uint32_t                           DoneTick;
+  LVGL_UEFI_HEAP_STATS               Heap;
+  UINT32                             Index;
+
+  if (mGovernor.Disp != NULL) {
+    lv_display_add_event_cb (mGovernor.Disp, UefiLvglReplayEvtCb, LV_EVENT_REFR_START, &mReplay);
+    lv_display_add_event_cb (mGovernor.Disp, UefiLvglReplayEvtCb, LV_EVENT_REFR_READY, &mReplay);
+  }
+
+  Done = FALSE;
+  DoneTick = 0;
+  while (mExitBtnYes != EXIT_BTN_YES) {
+    lv_timer_handler ();
+    UefiLvglLatencySettle (mGovernor.Disp);
+    UefiLvglGovernorUpdate ();
+
+    //
+    // The governor pauses the input read timers when idle, read the
+    // devices on every pass instead.
+    //
+    lv_port_indev_poll ();
+    for (Indev = lv_indev_get_next (NULL); Indev != NULL; Indev = lv_indev_get_next (Indev)) {
+      lv_indev_read (Indev);
+    }
+
+    if (lv_port_indev_replay_done ()) {
+      if (!Done) {
+        Done = TRUE;
+        DoneTick = mReplay.Tick;
+      } else if (mReplay.Tick - DoneTick >= UEFI_LVGL_REPLAY_TAIL_MS) {
+        break;
+      }
+    }
+    mReplay.Tick += UEFI_LVGL_REPLAY_TICK_MS;
+  }
+
+  if (mGovernor.Disp != NULL) {
+    lv_display_remove_event_cb_with_user_data (mGovernor.Disp, UefiLvglReplayEvtCb, &mReplay);
+  }
+
+  LvglUefiHeapGetStats (&Heap);
+  DebugPrint (DEBUG_INFO, "LVGL replay: %d frames in %d ms, avg %d us, max %d us, heap peak %ld in use %ld bytes\n",
+              mReplay.Frames, mReplay.Tick, mReplay.Frames != 0 ? (UINT32)DivU64x32 (mReplay.TotalUs, mReplay.Frames) : 0,
+              mReplay.MaxUs, (UINT64)Heap.Peak, (UINT64)Heap.InUse);
+
+  //
+  // Replaying the same log with PcdLvglHeapArenaPages at 0 gives the same
+  // figures for the firmware pool.
+  //
+  if (mTickFreq != 0 && Heap.Allocs != 0 && Heap.Frees != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL replay: %ld allocs avg %ld ns, %ld frees avg %ld ns\n",
+                Heap.Allocs, UefiLvglTicksPerCall (Heap.AllocTicks, Heap.Allocs),
+                Heap.Frees, UefiLvglTicksPerCall (Heap.FreeTicks, Heap.Frees));
+  }
+  if (Heap.Reallocs != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL replay: %ld reallocs, %ld in place, %ld bytes copied\n",
+                Heap.Reallocs, Heap.ReallocsInPlace, Heap.ReallocCopied);
+  }
+  if (Heap.ArenaRegions != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL replay: arena %ld regions of %ld bytes, %ld free, largest free block %ld\n",
+                (UINT64)Heap.ArenaRegions, (UINT64)Heap.ArenaBytes, (UINT64)Heap.ArenaFree,
+                (UINT64)Heap.ArenaLargestFree);
+  }
+  if (Heap.Frames != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL replay: frame arena %ld blocks, %d of %d frames without a pool allocation\n",
+                Heap.FrameAllocs, Heap.FramesNoPool, Heap.Frames);
+  }
+  for (Index = 0; Index < LVGL_UEFI_SLAB_CLASSES; Index++) {
+    if (Heap.SlabsPeak[Index] != 0) {
+      DebugPrint (DEBUG_INFO, "LVGL replay: %d byte slabs: %d (peak %d), %d objects\n",
+                  Heap.SlabSize[Index], Heap.Slabs[Index], Heap.SlabsPeak[Index], Heap.SlabObjects[Index]);
+    }
+  }
+}
+
+
+/**
+  Run LVGL until the exit dialog is confirmed.
+
+  The CPU sleeps in WaitForEvent instead of spinning: a one-shot timer is
+  armed with the delay lv_timer_handler() reports until its next timer is
+  due, and the ConIn and pointer events wake the loop as soon as input
+  arrives. The device that woke it is read right away rather than at its
+  next LVGL read period.
+**/
+STATIC
+VOID
+UefiLvglRunLoop (
+  VOID
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_EVENT                          TimerEvent;
+  EFI_EVENT                          TickEvent;
+  EFI_EVENT                          WaitList[UEFI_LVGL_MAX_WAIT_EVENTS];
+  lv_indev_t                         *WaitIndev[UEFI_LVGL_MAX_WAIT_EVENTS];
+  UINTN                              WaitCount;
+  UINTN                              Index;
+  UINT32                             Delay;
+
+  if (lv_port_indev_replaying ()) {
+    UefiLvglReplayLoop ();
+    return;
+  }
+
+  TickEvent = NULL;
+  if (!mTickSupport) {
+    Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, UefiLvglTickNotify, NULL, &TickEvent);
+    if (!EFI_ERROR (Status)) {
+      Status = gBS->SetTimer (TickEvent, TimerPeriodic, EFI_TIMER_PERIOD_MILLISECONDS (UEFI_LVGL_TICK_PERIOD_MS));
+    }
+    if (EFI_ERROR (Status)) {
+      DebugPrint (DEBUG_ERROR, "LVGL: cannot create the tick timer - %r\n", Status);
+      if (TickEvent != NULL) {
+        gBS->CloseEvent (TickEvent);
+      }
+      return;
+    }
+  }
+
+  Status = gBS->CreateEvent (EVT_TIMER, TPL_APPLICATION, NULL, NULL, &TimerEvent);
+  if (EFI_ERROR (Status)) {
+    DebugPrint (DEBUG_ERROR, "LVGL: cannot create the loop timer - %r\n", Status);
+    if (TickEvent != NULL) {
+      gBS->CloseEvent (TickEvent);
+    }
+    return;
+  }
+
+  WaitList[0] = TimerEvent;
+  WaitIndev[0] = NULL;
+
+  while (mExitBtnYes != EXIT_BTN_YES) {
+    Delay = lv_timer_handler ();
+    UefiLvglLatencySettle (mGovernor.Disp);
+    if (mExitBtnYes == EXIT_BTN_YES || Delay == 0) {
+      continue;
+    }
+
+    //
+    // An invalidation during this pass made the refresh timer ready after
+    // lv_timer_handler() worked out the delay.
+    //
+    if (mGovernor.Dirty && mGovernor.Mode != LvglRefreshAnimated) {
+      continue;
+    }
+
+    //
+    // New timer periods change the delay lv_timer_handler() reported.
+    //
+    if (UefiLvglGovernorUpdate ()) {
+      continue;
+    }
+
+    //
+    // Keystrokes UefiLvglSchedPoll moved into the port queue during a
+    // refresh no longer signal WaitForKeyEx, nor do synthesised repeats.
+    //
+    if (lv_port_indev_poll ()) {
+      lv_indev_read (lv_port_indev_get_keypad ());
+      continue;
+    }
+
+    if (Delay == LV_NO_TIMER_READY) {
+      gBS->SetTimer (TimerEvent, TimerCancel, 0);
+    } else {
+      gBS->SetTimer (TimerEvent, TimerRelative, EFI_TIMER_PERIOD_MILLISECONDS (Delay));
+    }
+
+    WaitCount = 1 + lv_port_indev_get_wait_events (&WaitList[1], &WaitIndev[1], UEFI_LVGL_MAX_WAIT_EVENTS - 1);
+    Status = gBS->WaitForEvent (WaitCount, WaitList, &Index);
+    if (!EFI_ERROR (Status) && WaitIndev[Index] != NULL) {
+      lv_indev_read (WaitIndev[Index]);
+    }
+  }
+
+  gBS->CloseEvent (TimerEvent);
+  if (TickEvent != NULL) {
+    gBS->CloseEvent (TickEvent);
+  }
+
+  if (mSched.BudgetMs != 0) {
+    DebugPrint (DEBUG_INFO, "LVGL: %d frames, %d over the %d ms budget (worst %d ms), %d keyboard polls during them\n",
+                mSched.Frames, mSched.Overruns, mSched.BudgetMs, mSched.WorstMs, mSched.Polls);
+  }
+}
+
+
 EFI_STATUS
 EFIAPI
 UefiLvglAppRegister (
@@ -127,18 +1330,7 @@ UefiLvglAppRegister (
 
     LvglUefiEscExitRegister ();
 
-    while (1) {
-      if (mExitBtnYes == EXIT_BTN_YES) {
-        break;
-      }
-
-      lv_timer_handler();
-
-      gBS->Stall (10 * 1000);
-      if (!mTickSupport) {
-        lv_tick_inc(10);
-      }
-    }
+    UefiLvglRunLoop ();
   } else {
     UefiLvglDeinit();
     return EFI_UNSUPPORTED;
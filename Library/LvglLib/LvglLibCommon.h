@@ -15,10 +15,15 @@
 #include <Library/BaseLib.h>
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/TimerLib.h>
+#include <Library/PcdLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <Library/CacheMaintenanceLib.h>
 #include <Protocol/GraphicsOutput.h>
 #include <Protocol/SimpleTextInEx.h>
 #include <Protocol/SimplePointer.h>
 #include <Protocol/AbsolutePointer.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
 
 #include "LvglUefiPort.h"
 
@@ -27,8 +32,64 @@
 #define  EXIT_BTN_YES   0x1
 #define  EXIT_BTN_NO    0x2
 
+//
+// PcdLvglInputMode: input devices read normally, recorded to the input log
+// or replayed from it with a virtual tick.
+//
+#define  LVGL_INPUT_LIVE    0x0
+#define  LVGL_INPUT_RECORD  0x1
+#define  LVGL_INPUT_REPLAY  0x2
 
-lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res);
+
+typedef enum {
+    LV_UEFI_DISP_BACKEND_BLT = 0,       /**< GOP Blt of every flushed area*/
+    LV_UEFI_DISP_BACKEND_LFB_DIRECT,    /**< LVGL renders into the linear framebuffer*/
+    LV_UEFI_DISP_BACKEND_LFB_FLIP,      /**< Back buffer, flushed areas copied to the framebuffer*/
+} lv_uefi_disp_backend_t;
+
+typedef struct {
+    lv_uefi_disp_backend_t   backend;
+    lv_display_render_mode_t render_mode;   /**< DIRECT or PARTIAL*/
+    uint32_t                 band_divisor;  /**< PARTIAL: a band holds 1/band_divisor of the lines*/
+    uint32_t                 band_count;    /**< PARTIAL: 1 or 2 band buffers*/
+    uint32_t                 merge_slack;   /**< DIRECT: max unchanged pixels a merged rectangle may add*/
+    bool                     tile_diff;     /**< Skip tiles identical to the last presented frame*/
+    lv_display_rotation_t    rotation;      /**< Clockwise rotation from LVGL to the GOP mode*/
+} lv_uefi_disp_config_t;
+
+UINT32 lv_uefi_disp_locate_outputs(EFI_GRAPHICS_OUTPUT_PROTOCOL ** Gop, UINT32 Max);
+
+lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res, const lv_uefi_disp_config_t * config);
+
+void lv_uefi_disp_get_native_resolution(lv_display_t * disp, int32_t * hor_res, int32_t * ver_res);
+
+void lv_uefi_disp_native_to_logical(lv_display_t * disp, lv_point_t * point);
+
+void lv_uefi_disp_rotate_motion(lv_display_t * disp, lv_point_t * delta);
+
+bool lv_uefi_disp_set_cursor(lv_display_t * disp, const lv_image_dsc_t * icon);
+
+void lv_uefi_disp_move_cursor(lv_display_t * disp, const lv_point_t * pos);
+
+UINTN lv_port_indev_get_wait_events(EFI_EVENT * events, lv_indev_t ** indevs, UINTN max);
+
+bool lv_port_indev_poll(void);
+
+lv_indev_t * lv_port_indev_get_keypad(void);
+
+bool lv_port_indev_replaying(void);
+
+bool lv_port_indev_replay_done(void);
+
+VOID
+UefiLvglLatencyInput (
+  IN UINT64  Stamp
+  );
+
+VOID
+UefiLvglLatencyShown (
+  VOID
+  );
 
 VOID
 EFIAPI
@@ -1,7 +1,15 @@
 
 #include "LvglUefiPort.h"
 
-#define LVGL_HEAD_SIGNATURE  SIGNATURE_32('l','v','g','l')
+#include <Library/LvglMemoryLib.h>
+#include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
+
+#define LVGL_HEAD_SIGNATURE   SIGNATURE_32('l','v','g','l')
+#define LVGL_ARENA_SIGNATURE  SIGNATURE_32('l','v','g','a')
+#define LVGL_SLAB_SIGNATURE   SIGNATURE_32('l','v','g','s')
+#define LVGL_SLAB_FREED       SIGNATURE_32('l','v','g','f')
+#define LVGL_FRAME_SIGNATURE  SIGNATURE_32('l','v','g','t')
 
 typedef struct {
   UINT32    Signature;
@@ -10,33 +18,979 @@ typedef struct {
 
 #define LVGL_OVERHEAD  sizeof(LVGL_HEAD)
 
+//
+// Blocks from the pool and the frame arena keep the size they were
+// allocated with in front of their LVGL_HEAD, the size in the head is
+// what was last asked.
+//
+typedef struct {
+  UINTN      Capacity;        // class or bumped size, LVGL_HEAD included
+  UINTN      Reserved;        // keeps the payload aligned
+  LVGL_HEAD  Head;
+} LVGL_POOL_BLOCK;
+
+#define LVGL_POOL_HDR  OFFSET_OF (LVGL_POOL_BLOCK, Head)
+
+//
+// TLSF arena: blocks are carved from regions of PcdLvglHeapArenaPages pages
+// and kept on segregated free lists, 16 per power of two, so that malloc
+// and free are a few bitmap scans and list operations and never reach the
+// firmware pool. Only called from LVGL, at TPL_APPLICATION.
+//
+// Every block starts with a header giving its physical neighbour before it
+// and its payload size, the payload of a used block with the LVGL_HEAD.
+// Blocks larger than a quarter of a region come from the pool.
+//
+#define LVGL_ARENA_ALIGN        (2 * sizeof (UINTN))
+#define LVGL_ARENA_ALIGN_LOG2   (sizeof (UINTN) == 8 ? 4 : 3)
+#define LVGL_ARENA_SL_LOG2      4
+#define LVGL_ARENA_SL_COUNT     (1 << LVGL_ARENA_SL_LOG2)
+#define LVGL_ARENA_FL_SHIFT     (LVGL_ARENA_SL_LOG2 + LVGL_ARENA_ALIGN_LOG2)
+#define LVGL_ARENA_FL_MAX       28                    // regions up to 256 MB
+#define LVGL_ARENA_FL_COUNT     (LVGL_ARENA_FL_MAX - LVGL_ARENA_FL_SHIFT + 1)
+#define LVGL_ARENA_SMALL        ((UINTN)1 << LVGL_ARENA_FL_SHIFT)
+
+#define LVGL_ARENA_FREE         BIT0
+
+typedef struct _LVGL_ARENA_BLOCK LVGL_ARENA_BLOCK;
+
+struct _LVGL_ARENA_BLOCK {
+  LVGL_ARENA_BLOCK  *PrevPhys;      // block before this one, NULL for the first of a region
+  UINTN             Size;           // payload bytes | LVGL_ARENA_FREE, 0 for the region end
+  LVGL_ARENA_BLOCK  *NextFree;      // free blocks only, in the payload
+  LVGL_ARENA_BLOCK  *PrevFree;
+};
+
+#define LVGL_ARENA_HDR          OFFSET_OF (LVGL_ARENA_BLOCK, NextFree)
+
+typedef struct _LVGL_ARENA_REGION LVGL_ARENA_REGION;
+
+struct _LVGL_ARENA_REGION {
+  LVGL_ARENA_REGION  *Next;
+  UINTN              Pages;
+};
+
+#define LVGL_ARENA_REGION_HDR   ALIGN_VALUE (sizeof (LVGL_ARENA_REGION), LVGL_ARENA_ALIGN)
+
+typedef struct {
+  UINT32             FlBitmap;
+  UINT32             SlBitmap[LVGL_ARENA_FL_COUNT];
+  LVGL_ARENA_BLOCK   *Free[LVGL_ARENA_FL_COUNT][LVGL_ARENA_SL_COUNT];
+  LVGL_ARENA_REGION  *Regions;
+  UINTN              RegionCount;
+  UINTN              RegionBytes;
+  UINTN              FreeBytes;
+} LVGL_ARENA;
+
+STATIC LVGL_ARENA            mArena;
+
+//
+// Slabs: requests of up to LVGL_SLAB_MAX bytes with their LVGL_HEAD are
+// served from pages of objects of one size class, handed out from a free
+// list or, on a page not used up yet, carved from its end. The page a
+// freed object belongs to is found by rounding its address down.
+//
+#define LVGL_SLAB_MAX           384
+
+typedef struct _LVGL_SLAB_OBJECT LVGL_SLAB_OBJECT;
+
+struct _LVGL_SLAB_OBJECT {
+  UINT32            Signature;        // LVGL_SLAB_FREED
+  LVGL_SLAB_OBJECT  *NextFree;        // where the LVGL_HEAD keeps the size
+};
+
+typedef struct _LVGL_SLAB LVGL_SLAB;
+
+struct _LVGL_SLAB {
+  LVGL_SLAB         *Next;            // slabs of the class with free objects
+  LVGL_SLAB         *Prev;
+  LVGL_SLAB_OBJECT  *FreeList;
+  UINT16            Used;
+  UINT16            Carved;           // objects handed out at least once
+  UINT16            Count;
+  UINT8             Class;
+};
+
+#define LVGL_SLAB_HDR           ALIGN_VALUE (sizeof (LVGL_SLAB), LVGL_ARENA_ALIGN)
+
+typedef struct {
+  LVGL_SLAB         *Partial;
+  UINT32            Slabs;
+  UINT32            SlabsPeak;
+  UINT32            Objects;
+} LVGL_SLAB_CLASS;
+
+STATIC CONST UINT16  mSlabSize[LVGL_UEFI_SLAB_CLASSES] = {
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384
+};
+
+STATIC LVGL_SLAB_CLASS       mSlab[LVGL_UEFI_SLAB_CLASSES];
+
+//
+// Frame arena: while a frame is rendered, the draw buffers of
+// LVGL_UEFI_HEAP_FRAME, its layers, are bumped off a chunk of
+// PcdLvglHeapFramePages pages. They are freed again by the end of the
+// frame, and the chunk is reset when its last block goes, without a walk
+// of its blocks.
+// A block that outlives its frame keeps its chunk until it is freed, the
+// next blocks go to another chunk. Chunks are aligned to their size, so
+// the chunk of a block is found by rounding its address down. Empty chunks
+// are kept for as many as the last frame took.
+//
+typedef struct _LVGL_FRAME_CHUNK LVGL_FRAME_CHUNK;
+
+struct _LVGL_FRAME_CHUNK {
+  LVGL_FRAME_CHUNK  *Next;            // spare chunks only
+  UINTN             Top;              // offset of the next block
+  UINTN             Live;             // blocks not freed yet
+};
+
+#define LVGL_FRAME_CHUNK_HDR    ALIGN_VALUE (sizeof (LVGL_FRAME_CHUNK), LVGL_ARENA_ALIGN)
+#define LVGL_FRAME_PAGES        FixedPcdGet16 (PcdLvglHeapFramePages)
+#define LVGL_FRAME_BYTES        EFI_PAGES_TO_SIZE (LVGL_FRAME_PAGES)
+
+typedef struct {
+  BOOLEAN           Active;
+  LVGL_FRAME_CHUNK  *Current;
+  LVGL_FRAME_CHUNK  *Spare;           // empty chunks kept for the next frames
+  UINT32            SpareCount;
+  UINT32            Taken;            // chunks made current during the frame
+  UINT64            PoolAllocs;       // mHeapStats.PoolAllocs at the frame start
+} LVGL_FRAME;
+
+STATIC LVGL_FRAME            mFrame;
+
+//
+// Allocation counters, see LvglUefiHeapGetStats.
+//
+STATIC LVGL_UEFI_HEAP_STATS  mHeapStats;
+
 void* memset (void *dest, char ch, unsigned int count)
 {
   return SetMem (dest, count, ch);
 }
 
 
+STATIC
+LVGL_ARENA_BLOCK *
+ArenaNext (
+  IN LVGL_ARENA_BLOCK  *Block
+  )
+{
+  return (LVGL_ARENA_BLOCK *)((UINT8 *)Block + LVGL_ARENA_HDR + (Block->Size & ~LVGL_ARENA_FREE));
+}
+
+
+/**
+  Free list of a block size: first level by power of two, second level by
+  sixteenth of it. Sizes below LVGL_ARENA_SMALL share the first list.
+**/
+STATIC
+VOID
+ArenaMapping (
+  IN  UINTN   Size,
+  OUT UINT32  *Fl,
+  OUT UINT32  *Sl
+  )
+{
+  UINT32  Bit;
+
+  if (Size < LVGL_ARENA_SMALL) {
+    *Fl = 0;
+    *Sl = (UINT32)(Size / LVGL_ARENA_ALIGN);
+    return;
+  }
+
+  Bit = (UINT32)HighBitSet64 (Size);
+  *Sl = (UINT32)RShiftU64 (Size, Bit - LVGL_ARENA_SL_LOG2) ^ LVGL_ARENA_SL_COUNT;
+  *Fl = Bit - LVGL_ARENA_FL_SHIFT + 1;
+}
+
+
+STATIC
+VOID
+ArenaInsert (
+  IN LVGL_ARENA_BLOCK  *Block
+  )
+{
+  UINT32  Fl;
+  UINT32  Sl;
+
+  ArenaMapping (Block->Size, &Fl, &Sl);
+  Block->Size |= LVGL_ARENA_FREE;
+  Block->PrevFree = NULL;
+  Block->NextFree = mArena.Free[Fl][Sl];
+  if (Block->NextFree != NULL) {
+    Block->NextFree->PrevFree = Block;
+  }
+  mArena.Free[Fl][Sl] = Block;
+  mArena.FlBitmap |= 1U << Fl;
+  mArena.SlBitmap[Fl] |= 1U << Sl;
+  mArena.FreeBytes += Block->Size & ~LVGL_ARENA_FREE;
+}
+
+
+STATIC
+VOID
+ArenaRemove (
+  IN LVGL_ARENA_BLOCK  *Block
+  )
+{
+  UINT32  Fl;
+  UINT32  Sl;
+
+  Block->Size &= ~LVGL_ARENA_FREE;
+  ArenaMapping (Block->Size, &Fl, &Sl);
+  if (Block->NextFree != NULL) {
+    Block->NextFree->PrevFree = Block->PrevFree;
+  }
+  if (Block->PrevFree != NULL) {
+    Block->PrevFree->NextFree = Block->NextFree;
+  } else {
+    mArena.Free[Fl][Sl] = Block->NextFree;
+    if (Block->NextFree == NULL) {
+      mArena.SlBitmap[Fl] &= ~(1U << Sl);
+      if (mArena.SlBitmap[Fl] == 0) {
+        mArena.FlBitmap &= ~(1U << Fl);
+      }
+    }
+  }
+  mArena.FreeBytes -= Block->Size;
+}
+
+
+/**
+  Round a block size up to its size class, the smallest size of the next
+  free list. Blocks are handed out at their class size: the few percent
+  of slack let realloc grow them in place.
+**/
+STATIC
+UINTN
+ArenaClassSize (
+  IN UINTN  Size
+  )
+{
+  UINTN  Step;
+
+  if (Size < LVGL_ARENA_SMALL) {
+    return ALIGN_VALUE (Size, LVGL_ARENA_ALIGN);
+  }
+
+  Step = (UINTN)LShiftU64 (1, HighBitSet64 (Size) - LVGL_ARENA_SL_LOG2);
+  return ALIGN_VALUE (Size, Step);
+}
+
+
+/**
+  Find a free block of at least Size bytes in O(1): Size is rounded up to
+  its size class, so any block of the first non-empty list from there on
+  fits.
+**/
+STATIC
+LVGL_ARENA_BLOCK *
+ArenaFind (
+  IN UINTN  Size
+  )
+{
+  UINT32  Fl;
+  UINT32  Sl;
+  UINT32  Map;
+
+  ArenaMapping (ArenaClassSize (Size), &Fl, &Sl);
+  if (Fl >= LVGL_ARENA_FL_COUNT) {
+    return NULL;
+  }
+
+  Map = mArena.SlBitmap[Fl] & (MAX_UINT32 << Sl);
+  if (Map == 0) {
+    Map = Fl + 1 < LVGL_ARENA_FL_COUNT ? mArena.FlBitmap & (MAX_UINT32 << (Fl + 1)) : 0;
+    if (Map == 0) {
+      return NULL;
+    }
+    Fl = (UINT32)LowBitSet32 (Map);
+    Map = mArena.SlBitmap[Fl];
+  }
+  Sl = (UINT32)LowBitSet32 (Map);
+
+  return mArena.Free[Fl][Sl];
+}
+
+
+/**
+  Add a region of pages to the arena, as one free block.
+**/
+STATIC
+BOOLEAN
+ArenaGrow (
+  VOID
+  )
+{
+  LVGL_ARENA_REGION  *Region;
+  LVGL_ARENA_BLOCK   *Block;
+  LVGL_ARENA_BLOCK   *End;
+  UINTN              Pages;
+
+  Pages = FixedPcdGet16 (PcdLvglHeapArenaPages);
+  Region = AllocatePages (Pages);
+  mHeapStats.PoolAllocs++;
+  if (Region == NULL) {
+    return FALSE;
+  }
+
+  Region->Pages = Pages;
+  Region->Next = mArena.Regions;
+  mArena.Regions = Region;
+  mArena.RegionCount++;
+  mArena.RegionBytes += EFI_PAGES_TO_SIZE (Pages);
+
+  Block = (LVGL_ARENA_BLOCK *)((UINT8 *)Region + LVGL_ARENA_REGION_HDR);
+  Block->PrevPhys = NULL;
+  Block->Size = EFI_PAGES_TO_SIZE (Pages) - LVGL_ARENA_REGION_HDR - 2 * LVGL_ARENA_HDR;
+  End = ArenaNext (Block);
+  End->PrevPhys = Block;
+  End->Size = 0;
+  ArenaInsert (Block);
+
+  return TRUE;
+}
+
+
+/**
+  Give a region back to the firmware, once all of it is one free block.
+**/
+STATIC
+VOID
+ArenaShrink (
+  IN LVGL_ARENA_BLOCK  *Block
+  )
+{
+  LVGL_ARENA_REGION  *Region;
+  LVGL_ARENA_REGION  **Link;
+
+  Region = (LVGL_ARENA_REGION *)((UINT8 *)Block - LVGL_ARENA_REGION_HDR);
+  for (Link = &mArena.Regions; *Link != Region; Link = &(*Link)->Next) {
+  }
+  *Link = Region->Next;
+  mArena.RegionCount--;
+  mArena.RegionBytes -= EFI_PAGES_TO_SIZE (Region->Pages);
+  FreePages (Region, Region->Pages);
+}
+
+
+/**
+  Cut a used block down to a payload of Size bytes. The rest goes back to
+  the free lists, merged with a free block after it, when it can hold a
+  block of its own.
+**/
+STATIC
+VOID
+ArenaTrim (
+  IN LVGL_ARENA_BLOCK  *Block,
+  IN UINTN             Size
+  )
+{
+  LVGL_ARENA_BLOCK  *Rest;
+  LVGL_ARENA_BLOCK  *Next;
+
+  if (Block->Size < Size + LVGL_ARENA_HDR + LVGL_ARENA_ALIGN) {
+    return;
+  }
+
+  Rest = (LVGL_ARENA_BLOCK *)((UINT8 *)Block + LVGL_ARENA_HDR + Size);
+  Rest->PrevPhys = Block;
+  Rest->Size = Block->Size - Size - LVGL_ARENA_HDR;
+  Block->Size = Size;
+
+  Next = ArenaNext (Rest);
+  if ((Next->Size & LVGL_ARENA_FREE) != 0) {
+    ArenaRemove (Next);
+    Rest->Size += LVGL_ARENA_HDR + Next->Size;
+  }
+  ArenaNext (Rest)->PrevPhys = Rest;
+  ArenaInsert (Rest);
+}
+
+
+/**
+  Take a block with a payload of Size bytes from the arena, growing it by
+  a region if no free block fits.
+**/
+STATIC
+LVGL_ARENA_BLOCK *
+ArenaAlloc (
+  IN UINTN  Size
+  )
+{
+  LVGL_ARENA_BLOCK  *Block;
+
+  Block = ArenaFind (Size);
+  if (Block == NULL) {
+    if (!ArenaGrow ()) {
+      return NULL;
+    }
+    Block = ArenaFind (Size);
+    if (Block == NULL) {
+      return NULL;
+    }
+  }
+  ArenaRemove (Block);
+  ArenaTrim (Block, Size);
+
+  return Block;
+}
+
+
+/**
+  Return a block to the arena, merged with its free neighbours.
+**/
+STATIC
+VOID
+ArenaFree (
+  IN LVGL_ARENA_BLOCK  *Block
+  )
+{
+  LVGL_ARENA_BLOCK  *Next;
+  LVGL_ARENA_BLOCK  *Prev;
+
+  Next = ArenaNext (Block);
+  if ((Next->Size & LVGL_ARENA_FREE) != 0) {
+    ArenaRemove (Next);
+    Block->Size += LVGL_ARENA_HDR + Next->Size;
+    ArenaNext (Block)->PrevPhys = Block;
+  }
+
+  Prev = Block->PrevPhys;
+  if (Prev != NULL && (Prev->Size & LVGL_ARENA_FREE) != 0) {
+    ArenaRemove (Prev);
+    Prev->Size += LVGL_ARENA_HDR + Block->Size;
+    Block = Prev;
+    ArenaNext (Block)->PrevPhys = Block;
+  }
+
+  //
+  // Keep one region, so that a page switch freeing everything does not
+  // hand it back only to allocate it again.
+  //
+  if (Block->PrevPhys == NULL && ArenaNext (Block)->Size == 0 && mArena.RegionCount > 1) {
+    ArenaShrink (Block);
+    return;
+  }
+
+  ArenaInsert (Block);
+}
+
+
+/**
+  Slab class of an object size: 16 byte steps up to 128, 32 byte steps
+  up to 256, 64 byte steps up to LVGL_SLAB_MAX.
+**/
+STATIC
+UINT32
+SlabClass (
+  IN UINTN  Object
+  )
+{
+  if (Object <= 128) {
+    return (UINT32)((Object + 15) / 16) - 1;
+  }
+  if (Object <= 256) {
+    return 8 + (UINT32)((Object - 129) / 32);
+  }
+  return 12 + (UINT32)((Object - 257) / 64);
+}
+
+
+STATIC
+VOID
+SlabLink (
+  IN LVGL_SLAB_CLASS  *Class,
+  IN LVGL_SLAB        *Slab
+  )
+{
+  Slab->Prev = NULL;
+  Slab->Next = Class->Partial;
+  if (Slab->Next != NULL) {
+    Slab->Next->Prev = Slab;
+  }
+  Class->Partial = Slab;
+}
+
+
+STATIC
+VOID
+SlabUnlink (
+  IN LVGL_SLAB_CLASS  *Class,
+  IN LVGL_SLAB        *Slab
+  )
+{
+  if (Slab->Next != NULL) {
+    Slab->Next->Prev = Slab->Prev;
+  }
+  if (Slab->Prev != NULL) {
+    Slab->Prev->Next = Slab->Next;
+  } else {
+    Class->Partial = Slab->Next;
+  }
+}
+
+
+/**
+  Take an object of a slab class, starting a new page of them when no
+  slab of the class has one free.
+**/
+STATIC
+LVGL_HEAD *
+SlabAlloc (
+  IN UINT32  Index
+  )
+{
+  LVGL_SLAB_CLASS   *Class;
+  LVGL_SLAB         *Slab;
+  LVGL_SLAB_OBJECT  *Object;
+
+  Class = &mSlab[Index];
+  Slab = Class->Partial;
+  if (Slab == NULL) {
+    Slab = AllocatePages (1);
+    mHeapStats.PoolAllocs++;
+    if (Slab == NULL) {
+      return NULL;
+    }
+    Slab->FreeList = NULL;
+    Slab->Used = 0;
+    Slab->Carved = 0;
+    Slab->Count = (UINT16)((EFI_PAGE_SIZE - LVGL_SLAB_HDR) / mSlabSize[Index]);
+    Slab->Class = (UINT8)Index;
+    SlabLink (Class, Slab);
+    Class->Slabs++;
+    Class->SlabsPeak = MAX (Class->SlabsPeak, Class->Slabs);
+  }
+
+  if (Slab->FreeList != NULL) {
+    Object = Slab->FreeList;
+    ASSERT (Object->Signature == LVGL_SLAB_FREED);
+    Slab->FreeList = Object->NextFree;
+  } else {
+    Object = (LVGL_SLAB_OBJECT *)((UINT8 *)Slab + LVGL_SLAB_HDR + Slab->Carved * mSlabSize[Index]);
+    Slab->Carved++;
+  }
+
+  Slab->Used++;
+  if (Slab->Used == Slab->Count) {
+    SlabUnlink (Class, Slab);
+  }
+  Class->Objects++;
+
+  return (LVGL_HEAD *)Object;
+}
+
+
+/**
+  Return an object to its slab. A slab left empty goes back to the
+  firmware, unless no other slab of its class has a free object: the
+  next allocation would only take a new page again.
+**/
+STATIC
+VOID
+SlabFree (
+  IN LVGL_HEAD  *Head
+  )
+{
+  LVGL_SLAB_CLASS   *Class;
+  LVGL_SLAB         *Slab;
+  LVGL_SLAB_OBJECT  *Object;
+
+  Slab = (LVGL_SLAB *)((UINTN)Head & ~(UINTN)EFI_PAGE_MASK);
+  Class = &mSlab[Slab->Class];
+  if (Slab->Used == Slab->Count) {
+    SlabLink (Class, Slab);
+  }
+
+  Object = (LVGL_SLAB_OBJECT *)Head;
+  Object->Signature = LVGL_SLAB_FREED;
+  Object->NextFree = Slab->FreeList;
+  Slab->FreeList = Object;
+  Slab->Used--;
+  Class->Objects--;
+
+  if (Slab->Used == 0 && (Class->Partial != Slab || Slab->Next != NULL)) {
+    SlabUnlink (Class, Slab);
+    Class->Slabs--;
+    FreePages (Slab, 1);
+  }
+}
+
+
+/**
+  Bump a block of Payload bytes off the current frame chunk, moving to a
+  spare chunk or a new one when it is full.
+**/
+STATIC
+LVGL_HEAD *
+FrameAlloc (
+  IN UINTN  Payload
+  )
+{
+  LVGL_FRAME_CHUNK  *Chunk;
+  LVGL_HEAD         *Head;
+
+  Chunk = mFrame.Current;
+  if (Chunk == NULL || Chunk->Top + Payload > LVGL_FRAME_BYTES) {
+    //
+    // A full chunk still has live blocks, or it would have been reset.
+    // FrameFree finds it by address once they are gone.
+    //
+    Chunk = mFrame.Spare;
+    if (Chunk != NULL) {
+      mFrame.Spare = Chunk->Next;
+      mFrame.SpareCount--;
+    } else {
+      Chunk = AllocateAlignedPages (LVGL_FRAME_PAGES, LVGL_FRAME_BYTES);
+      mHeapStats.PoolAllocs++;
+      if (Chunk == NULL) {
+        return NULL;
+      }
+      mHeapStats.FrameChunks++;
+      mHeapStats.FrameChunksPeak = MAX (mHeapStats.FrameChunksPeak, mHeapStats.FrameChunks);
+    }
+    Chunk->Top = LVGL_FRAME_CHUNK_HDR;
+    Chunk->Live = 0;
+    mFrame.Current = Chunk;
+    mFrame.Taken++;
+  }
+
+  Head = (LVGL_HEAD *)((UINT8 *)Chunk + Chunk->Top);
+  Chunk->Top += Payload;
+  Chunk->Live++;
+  mHeapStats.FrameAllocs++;
+  return Head;
+}
+
+
+/**
+  Release a block of the frame arena. The last block of a chunk resets it
+  as a whole: the current chunk is bumped from its start again, another
+  one becomes a spare.
+**/
+STATIC
+VOID
+FrameFree (
+  IN LVGL_HEAD  *Head
+  )
+{
+  LVGL_FRAME_CHUNK  *Chunk;
+
+  Chunk = (LVGL_FRAME_CHUNK *)((UINTN)Head & ~(LVGL_FRAME_BYTES - 1));
+  ASSERT (Chunk->Live != 0);
+  Chunk->Live--;
+  if (Chunk->Live != 0) {
+    return;
+  }
+
+  Chunk->Top = LVGL_FRAME_CHUNK_HDR;
+  if (Chunk != mFrame.Current) {
+    Chunk->Next = mFrame.Spare;
+    mFrame.Spare = Chunk;
+    mFrame.SpareCount++;
+  }
+}
+
+
+/**
+  Give back the spare chunks beyond Keep.
+**/
+STATIC
+VOID
+FrameShrink (
+  IN UINT32  Keep
+  )
+{
+  LVGL_FRAME_CHUNK  *Chunk;
+
+  while (mFrame.SpareCount > Keep) {
+    Chunk = mFrame.Spare;
+    mFrame.Spare = Chunk->Next;
+    mFrame.SpareCount--;
+    mHeapStats.FrameChunks--;
+    FreeAlignedPages (Chunk, LVGL_FRAME_PAGES);
+  }
+}
+
+
+/**
+  Allocate Size bytes behind an LVGL_HEAD: the layers of a frame being
+  rendered from the frame arena, other small requests
+  from a slab, the others from the arena or, for large blocks and with
+  PcdLvglHeapArenaPages at 0, from the pool. Arena and pool blocks are
+  rounded up to the size class.
+**/
+STATIC
+VOID *
+LvglHeapAlloc (
+  IN UINT32  Tag,
+  IN UINTN   Size
+  )
+{
+  LVGL_HEAD         *Head;
+  LVGL_ARENA_BLOCK  *Block;
+  LVGL_POOL_BLOCK   *Pool;
+  UINTN             Payload;
+  UINTN             Slot;
+
+  Head = NULL;
+  Payload = ArenaClassSize (LVGL_OVERHEAD + Size);
+  if (Payload <= Size) {
+    return NULL;
+  }
+
+  if (mFrame.Active && Tag == LVGL_UEFI_HEAP_FRAME &&
+      Payload <= (LVGL_FRAME_BYTES - LVGL_FRAME_CHUNK_HDR) / 2) {
+    Slot = ALIGN_VALUE (LVGL_OVERHEAD + Size, LVGL_ARENA_ALIGN);
+    Pool = (LVGL_POOL_BLOCK *)FrameAlloc (LVGL_POOL_HDR + Slot);
+    if (Pool != NULL) {
+      Pool->Capacity = Slot;
+      Head = &Pool->Head;
+      Head->Signature = LVGL_FRAME_SIGNATURE;
+    }
+  }
+
+  if (Head == NULL && FixedPcdGetBool (PcdLvglHeapSlabs) && Payload <= LVGL_SLAB_MAX) {
+    Head = SlabAlloc (SlabClass (Payload));
+    if (Head != NULL) {
+      Head->Signature = LVGL_SLAB_SIGNATURE;
+    }
+  }
+
+  if (Head == NULL && Payload <= EFI_PAGES_TO_SIZE (FixedPcdGet16 (PcdLvglHeapArenaPages)) / 4) {
+    Block = ArenaAlloc (Payload);
+    if (Block != NULL) {
+      Head = (LVGL_HEAD *)((UINT8 *)Block + LVGL_ARENA_HDR);
+      Head->Signature = LVGL_ARENA_SIGNATURE;
+    }
+  }
+
+  if (Head == NULL) {
+    Pool = AllocatePool (LVGL_POOL_HDR + Payload);
+    mHeapStats.PoolAllocs++;
+    if (Pool == NULL) {
+      return NULL;
+    }
+    Pool->Capacity = Payload;
+    Head = &Pool->Head;
+    Head->Signature = LVGL_HEAD_SIGNATURE;
+  }
+
+  Head->Size = Size;
+  mHeapStats.InUse += Size;
+  mHeapStats.Peak = MAX (mHeapStats.Peak, mHeapStats.InUse);
+  LvglMemoryCharge ((LVGL_MEMORY_TAG)Tag, 0, Size);
+  return Head + 1;
+}
+
+
+/**
+  Resize a block of LvglHeapAlloc without moving it.
+
+  An arena block grows into its slack and into a free block after it, and
+  gives back what it no longer needs when it shrinks. A slab object stays
+  as long as the size keeps its slab class. Frame arena and pool blocks
+  grow within the size they were allocated with, and a pool block shrinks
+  to no less than half of it so that large blocks do not pin much unused
+  memory. A frame block gives nothing back when it shrinks anyway.
+
+  @retval TRUE    The block holds Size bytes now.
+  @retval FALSE   The block must be moved.
+**/
+STATIC
+BOOLEAN
+LvglHeapResize (
+  IN UINT32     Tag,
+  IN LVGL_HEAD  *Head,
+  IN UINTN      Size
+  )
+{
+  LVGL_ARENA_BLOCK  *Block;
+  LVGL_ARENA_BLOCK  *Next;
+  LVGL_SLAB         *Slab;
+  UINTN             Payload;
+  UINTN             Capacity;
+
+  Payload = ArenaClassSize (LVGL_OVERHEAD + Size);
+  if (Payload <= Size) {
+    return FALSE;
+  }
+
+  if (Head->Signature == LVGL_ARENA_SIGNATURE) {
+    Block = (LVGL_ARENA_BLOCK *)((UINT8 *)Head - LVGL_ARENA_HDR);
+    if (Payload > Block->Size) {
+      Next = ArenaNext (Block);
+      if ((Next->Size & LVGL_ARENA_FREE) == 0 ||
+          Block->Size + LVGL_ARENA_HDR + (Next->Size & ~LVGL_ARENA_FREE) < Payload) {
+        return FALSE;
+      }
+      ArenaRemove (Next);
+      Block->Size += LVGL_ARENA_HDR + Next->Size;
+      ArenaNext (Block)->PrevPhys = Block;
+    }
+    ArenaTrim (Block, Payload);
+  } else if (Head->Signature == LVGL_SLAB_SIGNATURE) {
+    Slab = (LVGL_SLAB *)((UINTN)Head & ~(UINTN)EFI_PAGE_MASK);
+    if (Payload > LVGL_SLAB_MAX || SlabClass (Payload) != Slab->Class) {
+      return FALSE;
+    }
+  } else {
+    Capacity = ((LVGL_POOL_BLOCK *)((UINT8 *)Head - LVGL_POOL_HDR))->Capacity;
+    if (Head->Signature == LVGL_FRAME_SIGNATURE) {
+      Payload = ALIGN_VALUE (LVGL_OVERHEAD + Size, LVGL_ARENA_ALIGN);
+    }
+    if (Payload > Capacity ||
+        (Head->Signature == LVGL_HEAD_SIGNATURE && Payload < Capacity / 2)) {
+      return FALSE;
+    }
+  }
+
+  mHeapStats.InUse = mHeapStats.InUse - Head->Size + Size;
+  mHeapStats.Peak = MAX (mHeapStats.Peak, mHeapStats.InUse);
+  LvglMemoryCharge ((LVGL_MEMORY_TAG)Tag, Head->Size, Size);
+  Head->Size = Size;
+  return TRUE;
+}
+
+
+/**
+  Tell whether Ptr is a live block of LvglHeapAlloc. A freed block has
+  lost its signature.
+**/
+STATIC
+BOOLEAN
+LvglHeapOwns (
+  IN VOID  *Ptr
+  )
+{
+  LVGL_HEAD  *Head;
+
+  Head = (LVGL_HEAD *)Ptr - 1;
+  if (Head->Signature == LVGL_ARENA_SIGNATURE || Head->Signature == LVGL_SLAB_SIGNATURE ||
+      Head->Signature == LVGL_FRAME_SIGNATURE || Head->Signature == LVGL_HEAD_SIGNATURE) {
+    return TRUE;
+  }
+
+  DebugPrint (DEBUG_ERROR, "LVGL heap: %p is not an allocated block, ignored\n", Ptr);
+  return FALSE;
+}
+
+
+/**
+  Free a live block of LvglHeapAlloc.
+**/
+STATIC
+VOID
+LvglHeapFree (
+  IN UINT32  Tag,
+  IN VOID    *Ptr
+  )
+{
+  LVGL_HEAD  *Head;
+
+  Head = (LVGL_HEAD *)Ptr - 1;
+  mHeapStats.InUse -= Head->Size;
+  LvglMemoryCharge ((LVGL_MEMORY_TAG)Tag, Head->Size, 0);
+
+  if (Head->Signature == LVGL_ARENA_SIGNATURE) {
+    Head->Signature = 0;
+    ArenaFree ((LVGL_ARENA_BLOCK *)((UINT8 *)Head - LVGL_ARENA_HDR));
+  } else if (Head->Signature == LVGL_SLAB_SIGNATURE) {
+    SlabFree (Head);
+  } else if (Head->Signature == LVGL_FRAME_SIGNATURE) {
+    Head->Signature = 0;
+    FrameFree (Head);
+  } else {
+    Head->Signature = 0;
+    FreePool ((UINT8 *)Head - LVGL_POOL_HDR);
+  }
+}
+
+
+STATIC
+UINT64
+LvglHeapTicks (
+  IN UINT64  Start
+  )
+{
+  UINT64  Now;
+
+  Now = GetPerformanceCounter ();
+  return Now >= Start ? Now - Start : Start - Now;
+}
+
+
+/**
+  Allocate Size bytes for the subsystem Tag, an LVGL_MEMORY_TAG. The block
+  must be freed with LvglUefiHeapFree and the same tag.
+**/
+VOID *
+LvglUefiHeapAlloc (
+  IN UINT32  Tag,
+  IN UINTN   Size
+  )
+{
+  UINT64  Start;
+  VOID    *Data;
+
+  Start = GetPerformanceCounter ();
+  Data = LvglHeapAlloc (Tag, Size);
+  mHeapStats.Allocs++;
+  mHeapStats.AllocTicks += LvglHeapTicks (Start);
+
+  return Data;
+}
+
+
+VOID
+LvglUefiHeapFree (
+  IN UINT32  Tag,
+  IN VOID    *Ptr
+  )
+{
+  UINT64  Start;
+
+  if (Ptr == NULL || !LvglHeapOwns (Ptr)) {
+    return;
+  }
+
+  Start = GetPerformanceCounter ();
+  LvglHeapFree (Tag, Ptr);
+  mHeapStats.Frees++;
+  mHeapStats.FreeTicks += LvglHeapTicks (Start);
+}
+
+
 void *
 malloc (
   size_t  size
   )
 {
-  LVGL_HEAD  *PoolHdr;
-  UINTN         NewSize;
-  VOID          *Data;
+  return LvglUefiHeapAlloc (LVGL_UEFI_HEAP_OBJECTS, size);
+}
+
+void *
+calloc (
+  size_t  num,
+  size_t  size
+  )
+{
+  VOID  *Data;
 
-  NewSize = (UINTN)(size) + LVGL_OVERHEAD;
+  if (size != 0 && num > MAX_UINTN / size) {
+    return NULL;
+  }
 
-  Data = AllocatePool (NewSize);
+  Data = LvglUefiHeapAlloc (LVGL_UEFI_HEAP_OBJECTS, num * size);
   if (Data != NULL) {
-    PoolHdr            = (LVGL_HEAD *)Data;
-    PoolHdr->Signature = LVGL_HEAD_SIGNATURE;
-    PoolHdr->Size      = size;
-
-    return (VOID *)(PoolHdr + 1);
+    ZeroMem (Data, num * size);
   }
 
-  return NULL;
+  return Data;
 }
 
 void *
@@ -45,31 +999,34 @@ realloc (
   size_t  size
   )
 {
-  LVGL_HEAD  *OldPoolHdr;
-  LVGL_HEAD  *NewPoolHdr;
-  UINTN         OldSize;
-  UINTN         NewSize;
-  VOID          *Data;
+  UINT64     Start;
+  LVGL_HEAD  *OldHead;
+  VOID       *Data;
 
-  NewSize = (UINTN)size + LVGL_OVERHEAD;
-  Data    = AllocatePool (NewSize);
-  if (Data != NULL) {
-    NewPoolHdr            = (LVGL_HEAD *)Data;
-    NewPoolHdr->Signature = LVGL_HEAD_SIGNATURE;
-    NewPoolHdr->Size      = size;
-    if (ptr != NULL) {
-      OldPoolHdr = (LVGL_HEAD *)ptr - 1;
-      ASSERT (OldPoolHdr->Signature == LVGL_HEAD_SIGNATURE);
-      OldSize = OldPoolHdr->Size;
-
-      CopyMem ((VOID *)(NewPoolHdr + 1), ptr, MIN (OldSize, size));
-      FreePool ((VOID *)OldPoolHdr);
+  Start = GetPerformanceCounter ();
+  if (ptr == NULL) {
+    Data = LvglHeapAlloc (LVGL_UEFI_HEAP_OBJECTS, size);
+  } else if (!LvglHeapOwns (ptr)) {
+    return NULL;
+  } else {
+    OldHead = (LVGL_HEAD *)ptr - 1;
+    mHeapStats.Reallocs++;
+    if (LvglHeapResize (LVGL_UEFI_HEAP_OBJECTS, OldHead, size)) {
+      mHeapStats.ReallocsInPlace++;
+      Data = ptr;
+    } else {
+      Data = LvglHeapAlloc (LVGL_UEFI_HEAP_OBJECTS, size);
+      if (Data != NULL) {
+        CopyMem (Data, ptr, MIN (OldHead->Size, size));
+        mHeapStats.ReallocCopied += MIN (OldHead->Size, size);
+        LvglHeapFree (LVGL_UEFI_HEAP_OBJECTS, ptr);
+      }
     }
-
-    return (VOID *)(NewPoolHdr + 1);
   }
+  mHeapStats.Allocs++;
+  mHeapStats.AllocTicks += LvglHeapTicks (Start);
 
-  return NULL;
+  return Data;
 }
 
 void
@@ -77,19 +1034,136 @@ free (
   void  *ptr
   )
 {
-  VOID          *EvalOnce;
-  LVGL_HEAD  *PoolHdr;
+  LvglUefiHeapFree (LVGL_UEFI_HEAP_OBJECTS, ptr);
+}
+
 
-  EvalOnce = ptr;
-  if (EvalOnce == NULL) {
+/**
+  Get the malloc counters and the state of the arena and the slabs.
+
+  ArenaLargestFree against ArenaFree tells how fragmented the arena is:
+  the largest free block is found among the blocks of the highest
+  non-empty free list.
+**/
+VOID
+LvglUefiHeapGetStats (
+  OUT LVGL_UEFI_HEAP_STATS  *Stats
+  )
+{
+  LVGL_ARENA_BLOCK  *Block;
+  UINT32            Fl;
+  UINT32            Sl;
+  UINT32            Index;
+
+  CopyMem (Stats, &mHeapStats, sizeof (*Stats));
+  for (Index = 0; Index < LVGL_UEFI_SLAB_CLASSES; Index++) {
+    Stats->SlabSize[Index] = mSlabSize[Index];
+    Stats->Slabs[Index] = mSlab[Index].Slabs;
+    Stats->SlabsPeak[Index] = mSlab[Index].SlabsPeak;
+    Stats->SlabObjects[Index] = mSlab[Index].Objects;
+  }
+  Stats->ArenaRegions = mArena.RegionCount;
+  Stats->ArenaBytes = mArena.RegionBytes;
+  Stats->ArenaFree = mArena.FreeBytes;
+  Stats->ArenaLargestFree = 0;
+
+  if (mArena.FlBitmap != 0) {
+    Fl = (UINT32)HighBitSet32 (mArena.FlBitmap);
+    Sl = (UINT32)HighBitSet32 (mArena.SlBitmap[Fl]);
+    for (Block = mArena.Free[Fl][Sl]; Block != NULL; Block = Block->NextFree) {
+      Stats->ArenaLargestFree = MAX (Stats->ArenaLargestFree, Block->Size & ~LVGL_ARENA_FREE);
+    }
+  }
+}
+
+
+/**
+  Give the empty slabs, the arena regions that hold no block and the empty
+  frame chunks back to the firmware, once LVGL is shut down.
+**/
+VOID
+LvglUefiHeapTrim (
+  VOID
+  )
+{
+  LVGL_ARENA_REGION  *Region;
+  LVGL_ARENA_REGION  *Next;
+  LVGL_ARENA_BLOCK   *Block;
+  LVGL_SLAB          *Slab;
+  LVGL_SLAB          *NextSlab;
+  UINT32             Index;
+
+  for (Index = 0; Index < LVGL_UEFI_SLAB_CLASSES; Index++) {
+    for (Slab = mSlab[Index].Partial; Slab != NULL; Slab = NextSlab) {
+      NextSlab = Slab->Next;
+      if (Slab->Used == 0) {
+        SlabUnlink (&mSlab[Index], Slab);
+        mSlab[Index].Slabs--;
+        FreePages (Slab, 1);
+      }
+    }
+  }
+
+  for (Region = mArena.Regions; Region != NULL; Region = Next) {
+    Next = Region->Next;
+    Block = (LVGL_ARENA_BLOCK *)((UINT8 *)Region + LVGL_ARENA_REGION_HDR);
+    if ((Block->Size & LVGL_ARENA_FREE) != 0 && ArenaNext (Block)->Size == 0) {
+      ArenaRemove (Block);
+      ArenaShrink (Block);
+    }
+  }
+
+  if (mFrame.Current != NULL && mFrame.Current->Live == 0) {
+    mHeapStats.FrameChunks--;
+    FreeAlignedPages (mFrame.Current, LVGL_FRAME_PAGES);
+    mFrame.Current = NULL;
+  }
+  FrameShrink (0);
+}
+
+
+/**
+  Serve the LVGL_UEFI_HEAP_FRAME draw buffers allocated from now on from
+  the frame arena, until LvglUefiHeapFrameEnd. Called when a refresh
+  starts.
+**/
+VOID
+LvglUefiHeapFrameBegin (
+  VOID
+  )
+{
+  if (LVGL_FRAME_PAGES == 0) {
     return;
   }
 
-  PoolHdr = (LVGL_HEAD *)EvalOnce - 1;
-  if (PoolHdr->Signature == LVGL_HEAD_SIGNATURE) {
-    FreePool (PoolHdr);
-  } else {
-    FreePool (EvalOnce);
+  ASSERT ((LVGL_FRAME_PAGES & (LVGL_FRAME_PAGES - 1)) == 0);
+  mFrame.Active = TRUE;
+  mFrame.Taken = 0;
+  mFrame.PoolAllocs = mHeapStats.PoolAllocs;
+}
+
+
+/**
+  End the frame started by LvglUefiHeapFrameBegin, and count whether it
+  needed memory from the firmware. A frame only needs some when the frame
+  arena, the slabs or the arena have to grow. The frame arena keeps as
+  many spare chunks as this frame took, enough for a next one alike.
+**/
+VOID
+LvglUefiHeapFrameEnd (
+  VOID
+  )
+{
+  if (!mFrame.Active) {
+    return;
+  }
+
+  mFrame.Active = FALSE;
+  FrameShrink (mFrame.Taken);
+  mHeapStats.Frames++;
+  mHeapStats.FramePoolAllocs = (UINT32)(mHeapStats.PoolAllocs - mFrame.PoolAllocs);
+  if (mHeapStats.FramePoolAllocs == 0) {
+    mHeapStats.FramesNoPool++;
   }
 }
 
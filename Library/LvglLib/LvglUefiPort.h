@@ -58,7 +58,6 @@ typedef uint64_t  uint_fast64_t;
 #endif
 
 
-#define calloc(n, s)                      AllocateZeroPool((n)*(s))
 #define memcpy(dest,source,count)         CopyMem(dest,source,(UINTN)(count))
 // #define memset(dest,ch,count)             SetMem(dest,(UINTN)(count),(UINT8)(ch))
 #define memchr(buf,ch,count)              ScanMem8(buf,(UINTN)(count),(UINT8)ch)
@@ -120,6 +119,12 @@ malloc (
   size_t  size
   );
 
+void *
+calloc (
+  size_t  num,
+  size_t  size
+  );
+
 void *
 realloc (
   void    *ptr,
@@ -132,6 +137,74 @@ free (
   void  *ptr
   );
 
+#define LVGL_UEFI_SLAB_CLASSES  14
+
+//
+// Subsystems charged to LvglMemoryLib, the LVGL_MEMORY_TAG values.
+// malloc, calloc and realloc allocate as LVGL_UEFI_HEAP_OBJECTS.
+//
+#define LVGL_UEFI_HEAP_OBJECTS        0
+#define LVGL_UEFI_HEAP_FRAME          5
+
+typedef struct {
+  UINTN     InUse;              // bytes requested by live malloc/realloc blocks
+  UINTN     Peak;
+  UINT64    Allocs;             // malloc and realloc calls
+  UINT64    Frees;
+  UINT64    AllocTicks;         // performance counter ticks spent in them
+  UINT64    FreeTicks;
+  UINT64    Reallocs;           // realloc calls on an existing block
+  UINT64    ReallocsInPlace;    // of those, resized without a copy
+  UINT64    ReallocCopied;      // bytes copied by the others
+  UINT64    PoolAllocs;         // AllocatePool and AllocatePages calls of the heap
+  UINTN     ArenaRegions;
+  UINTN     ArenaBytes;         // pages held by the arena
+  UINTN     ArenaFree;          // free payload bytes in them
+  UINTN     ArenaLargestFree;
+  UINT16    SlabSize[LVGL_UEFI_SLAB_CLASSES];     // object size of every slab class
+  UINT32    Slabs[LVGL_UEFI_SLAB_CLASSES];        // pages held by the class
+  UINT32    SlabsPeak[LVGL_UEFI_SLAB_CLASSES];
+  UINT32    SlabObjects[LVGL_UEFI_SLAB_CLASSES];  // objects in use
+  UINT64    FrameAllocs;        // blocks taken from the frame arena
+  UINT32    FrameChunks;        // chunks held by the frame arena
+  UINT32    FrameChunksPeak;
+  UINT32    Frames;             // frames rendered with the frame arena
+  UINT32    FramesNoPool;       // of those, frames without a PoolAllocs call
+  UINT32    FramePoolAllocs;    // PoolAllocs calls of the last frame
+} LVGL_UEFI_HEAP_STATS;
+
+VOID *
+LvglUefiHeapAlloc (
+  IN UINT32  Tag,
+  IN UINTN   Size
+  );
+
+VOID
+LvglUefiHeapFree (
+  IN UINT32  Tag,
+  IN VOID    *Ptr
+  );
+
+VOID
+LvglUefiHeapGetStats (
+  OUT LVGL_UEFI_HEAP_STATS  *Stats
+  );
+
+VOID
+LvglUefiHeapTrim (
+  VOID
+  );
+
+VOID
+LvglUefiHeapFrameBegin (
+  VOID
+  );
+
+VOID
+LvglUefiHeapFrameEnd (
+  VOID
+  );
+
 long int labs (long int i);
 
 int abs (int i);
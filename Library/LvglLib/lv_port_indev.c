@@ -17,16 +17,96 @@
 
 extern const lv_img_dsc_t mouse_cursor_icon;
 
+/* Keystrokes read from the firmware that keypad_read() has not handed to LVGL yet */
+#define LVGL_UEFI_KEY_QUEUE_SIZE  32
+
+/* Firmware repeats of a key closer than this mean the key is held */
+#define LVGL_UEFI_KEY_REPEAT_STREAM_MS  150
+
+/* Synthesised repeats owed to LVGL at most, the rest are dropped */
+#define LVGL_UEFI_KEY_REPEAT_MAX_STEPS  16
+
+/* Pointer states sampled by the timer event and not yet handed to LVGL */
+#define LVGL_UEFI_POINTER_QUEUE_SIZE    32
+
+/* Pointer devices merged into the one cursor */
+#define LVGL_UEFI_MAX_POINTERS          6
+
+/* Simple pointer travel across the screen, in units of its resolution (counts/mm) */
+#define LVGL_UEFI_POINTER_TRAVEL        50
+
+/* Pointer sampling period, and unchanged samples after which it stops */
+#define LVGL_UEFI_POINTER_SAMPLE_MS     2
+#define LVGL_UEFI_POINTER_IDLE_SAMPLES  25
+
+/* Input log, see InputLogLoad */
+#define LVGL_UEFI_INPUT_LOG_SIGNATURE   SIGNATURE_32 ('L', 'V', 'I', 'R')
+#define LVGL_UEFI_INPUT_LOG_GROW        256
+
+#define LVGL_UEFI_INPUT_KEY             0
+#define LVGL_UEFI_INPUT_POINTER         1
+
 typedef struct {
+  INTN                           X;
+  INTN                           Y;
+  BOOLEAN                        Pressed;
+  BOOLEAN                        Transition;    /* button changed, never coalesced */
+  UINT64                         Stamp;         /* counter when GetState returned it, kept when coalescing */
+} LVGL_UEFI_POINTER_SAMPLE;
+
+typedef struct {
+  uint32_t                       Key;           /* LVGL key of the last keystroke, 0 if not repeatable */
+  uint32_t                       LastArrival;   /* tick of its last firmware keystroke */
+  uint32_t                       Interval;      /* firmware repeat interval, 0 while not held */
+  uint32_t                       HoldStart;     /* tick the key was found held */
+  uint32_t                       Credited;      /* tick up to which repeats are accounted */
+  uint32_t                       MilliSteps;    /* fraction of a repeat carried over, 1/1000 */
+  uint32_t                       Steps;         /* synthesised repeats not yet handed to LVGL */
+} LVGL_UEFI_KEY_REPEAT;
+
+typedef struct {
+  EFI_HANDLE                     Handle;
+  EFI_ABSOLUTE_POINTER_PROTOCOL  *AbsPointer;   /* exactly one of the two is set */
   EFI_SIMPLE_POINTER_PROTOCOL    *SimplePointer;
-  EFI_ABSOLUTE_POINTER_PROTOCOL  *AbsPointer;
+  UINT64                         ScaleX;        /* GOP pixels per device unit, 32.32 fixed point */
+  UINT64                         ScaleY;
+  BOOLEAN                        LeftButton;
+  BOOLEAN                        RightButton;
+} LVGL_UEFI_POINTER_DEVICE;
+
+typedef struct {
+  LVGL_UEFI_POINTER_DEVICE       Devices[LVGL_UEFI_MAX_POINTERS];
+  UINT32                         DeviceCount;
+  BOOLEAN                        Rescan;        /* a pointer protocol was installed */
+  EFI_EVENT                      AbsNotify;
+  EFI_EVENT                      SimpleNotify;
+  VOID                           *AbsRegistration;
+  VOID                           *SimpleRegistration;
+  INT32                          HorRes;        /* GOP resolution the scale factors map to */
+  INT32                          VerRes;
+  INT64                          FixX;          /* cursor in GOP coordinates, 32.32 fixed point */
+  INT64                          FixY;
   INTN                           LastCursorX;
   INTN                           LastCursorY;
   UINT32                         ActiveButtons;
-  BOOLEAN                        LeftButton;
+  BOOLEAN                        LeftButton;    /* any device */
   BOOLEAN                        RightButton;
 } LVGL_UEFI_MOUSE;
 
+typedef struct {
+  UINT32                         Signature;
+  UINT32                         Count;         /* records following the header */
+} LVGL_UEFI_INPUT_LOG_HEADER;
+
+typedef struct {
+  UINT32                         Tick;          /* ms since the log was started */
+  UINT8                          Type;          /* LVGL_UEFI_INPUT_KEY or _POINTER */
+  UINT8                          Pressed;       /* pointer: left button of any device */
+  UINT16                         Toggle;        /* key: KeyToggleState */
+  INT32                          X;             /* key: ScanCode | UnicodeChar << 16 */
+  INT32                          Y;             /* key: KeyShiftState */
+} LVGL_UEFI_INPUT_RECORD;
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -39,6 +119,10 @@ static void mouse_read(lv_indev_t * indev, lv_indev_data_t * data);
 
 static void keypad_read(lv_indev_t * indev, lv_indev_data_t * data);
 
+STATIC VOID InputRecordAppend (IN UINT8 Type, IN UINT8 Pressed, IN UINT16 Toggle, IN INT32 X, IN INT32 Y);
+
+STATIC VOID InputReplayPump (VOID);
+
 
 /**********************
  *  STATIC VARIABLES
@@ -48,6 +132,32 @@ lv_indev_t * indev_keypad;
 
 LVGL_UEFI_MOUSE mLvglUefiMouse;
 
+STATIC EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL  *mTxtInEx;
+STATIC EFI_KEY_DATA                       mKeyQueue[LVGL_UEFI_KEY_QUEUE_SIZE];
+STATIC uint32_t                           mKeyQueueTick[LVGL_UEFI_KEY_QUEUE_SIZE];
+STATIC UINT64                             mKeyQueueStamp[LVGL_UEFI_KEY_QUEUE_SIZE];
+STATIC UINT32                             mKeyQueueHead;
+STATIC UINT32                             mKeyQueueTail;
+STATIC uint32_t                           mKeyLast;
+STATIC BOOLEAN                            mKeyReleasePending;
+STATIC LVGL_UEFI_KEY_REPEAT                mKeyRepeat;
+
+STATIC LVGL_UEFI_POINTER_SAMPLE           mPointerQueue[LVGL_UEFI_POINTER_QUEUE_SIZE];
+STATIC UINT32                             mPointerQueueHead;
+STATIC UINT32                             mPointerQueueTail;
+STATIC BOOLEAN                            mPointerLastPressed;
+STATIC EFI_EVENT                          mPointerTimer;
+STATIC BOOLEAN                            mPointerSampling;
+STATIC UINT32                             mPointerIdle;
+STATIC BOOLEAN                            mCursorOverlay;
+
+STATIC UINT8                              mInputMode;
+STATIC LVGL_UEFI_INPUT_RECORD             *mInputLog;
+STATIC UINT32                             mInputLogCount;
+STATIC UINT32                             mInputLogSize;
+STATIC UINT32                             mInputLogNext;
+STATIC uint32_t                           mInputLogStart;
+
 /**********************
  *      MACROS
  **********************/
@@ -56,90 +166,298 @@ LVGL_UEFI_MOUSE mLvglUefiMouse;
  *   GLOBAL FUNCTIONS
  **********************/
 
-static void keypad_read(lv_indev_t * indev_drv, lv_indev_data_t * data)
+/**
+  Translate a keystroke to an LVGL key.
+
+  @return The LVGL key, 0 for keys LVGL has no use for.
+**/
+STATIC
+uint32_t
+KeyDataToLvKey (
+  IN EFI_KEY_DATA  *KeyData
+  )
 {
-  EFI_STATUS                         Status;
-  EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL  *TxtInEx;
-  EFI_KEY_DATA                       KeyData;
+  uint32_t                           Key = 0;
   UINT32                             KeyShift;
 
-  Status = gBS->HandleProtocol (gST->ConsoleInHandle, &gEfiSimpleTextInputExProtocolGuid, (VOID **)&TxtInEx);
-  Status = TxtInEx->ReadKeyStrokeEx (TxtInEx, &KeyData);
-  if (!EFI_ERROR (Status)) {
-    switch (KeyData.Key.UnicodeChar) {
-      case CHAR_CARRIAGE_RETURN:
-        data->key = LV_KEY_ENTER;
+  switch (KeyData->Key.UnicodeChar) {
+    case CHAR_CARRIAGE_RETURN:
+      Key = LV_KEY_ENTER;
+      break;
+
+    case CHAR_BACKSPACE:
+      Key = LV_KEY_BACKSPACE;
+      break;
+
+    case CHAR_TAB:
+      KeyShift = KeyData->KeyState.KeyShiftState;
+      Key = (KeyShift & EFI_SHIFT_STATE_VALID) && (KeyShift & (EFI_RIGHT_SHIFT_PRESSED | EFI_LEFT_SHIFT_PRESSED)) ? LV_KEY_PREV : LV_KEY_NEXT;
+      break;
+
+    case CHAR_NULL:
+      switch (KeyData->Key.ScanCode) {
+      case SCAN_UP:
+        Key = LV_KEY_UP;
+        break;
+      
+      case SCAN_DOWN:
+        Key = LV_KEY_DOWN;
+        break;
+
+      case SCAN_RIGHT:
+        Key = LV_KEY_RIGHT;
+        break;
+
+      case SCAN_LEFT:
+        Key = LV_KEY_LEFT;
         break;
 
-      case CHAR_BACKSPACE:
-        data->key = LV_KEY_BACKSPACE;
+      case SCAN_ESC:
+        Key = LV_KEY_ESC;
         break;
 
-      case CHAR_TAB:
-        KeyShift = KeyData.KeyState.KeyShiftState;
-        data->key = (KeyShift & EFI_SHIFT_STATE_VALID) && (KeyShift & (EFI_RIGHT_SHIFT_PRESSED | EFI_LEFT_SHIFT_PRESSED)) ? LV_KEY_PREV : LV_KEY_NEXT;
+      case SCAN_DELETE:
+        Key = LV_KEY_DEL;
         break;
 
-      case CHAR_NULL:
-        switch (KeyData.Key.ScanCode) {
-        case SCAN_UP:
-          data->key = LV_KEY_UP;
-          break;
-        
-        case SCAN_DOWN:
-          data->key = LV_KEY_DOWN;
-          break;
-
-        case SCAN_RIGHT:
-          data->key = LV_KEY_RIGHT;
-          break;
-
-        case SCAN_LEFT:
-          data->key = LV_KEY_LEFT;
-          break;
-
-        case SCAN_ESC:
-          data->key = LV_KEY_ESC;
-          break;
-
-        case SCAN_DELETE:
-          data->key = LV_KEY_DEL;
-          break;
-
-        case SCAN_PAGE_DOWN:
-          data->key = LV_KEY_NEXT;
-          break;
-
-        case SCAN_PAGE_UP:
-          data->key = LV_KEY_PREV;
-          break;
-
-        case SCAN_HOME:
-          data->key = LV_KEY_HOME;
-          break;
-
-        case SCAN_END:
-          data->key = LV_KEY_END;
-          break;
-
-        default:
-          break;
-        }
+      case SCAN_PAGE_DOWN:
+        Key = LV_KEY_NEXT;
         break;
 
-      case CHAR_LINEFEED:
+      case SCAN_PAGE_UP:
+        Key = LV_KEY_PREV;
+        break;
+
+      case SCAN_HOME:
+        Key = LV_KEY_HOME;
+        break;
+
+      case SCAN_END:
+        Key = LV_KEY_END;
         break;
 
       default:
-        data->key = KeyData.Key.UnicodeChar;
         break;
+      }
+      break;
+
+    case CHAR_LINEFEED:
+      break;
+
+    default:
+      Key = KeyData->Key.UnicodeChar;
+      break;
+  }
+
+  return Key;
+}
+
+
+/**
+  Move keystrokes from the firmware into the queue until ReadKeyStrokeEx
+  reports it empty or the queue is full.
+
+  @return TRUE if the queue holds keystrokes.
+**/
+STATIC
+BOOLEAN
+KeyQueueFill (
+  VOID
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_KEY_DATA                       *KeyData;
+
+  if (mInputMode == LVGL_INPUT_REPLAY) {
+    InputReplayPump ();
+    return mKeyQueueHead != mKeyQueueTail;
+  }
+
+  while (mKeyQueueHead - mKeyQueueTail < LVGL_UEFI_KEY_QUEUE_SIZE) {
+    KeyData = &mKeyQueue[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE];
+    if (mTxtInEx != NULL) {
+      Status = mTxtInEx->ReadKeyStrokeEx (mTxtInEx, KeyData);
+    } else {
+      ZeroMem (KeyData, sizeof (*KeyData));
+      Status = gST->ConIn->ReadKeyStroke (gST->ConIn, &KeyData->Key);
     }
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    mKeyQueueTick[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE] = lv_tick_get ();
+    mKeyQueueStamp[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE] = GetPerformanceCounter ();
+    mKeyQueueHead++;
+    if (mInputMode == LVGL_INPUT_RECORD) {
+      InputRecordAppend (LVGL_UEFI_INPUT_KEY, 0, KeyData->KeyState.KeyToggleState,
+                         (INT32)(KeyData->Key.ScanCode | ((UINT32)KeyData->Key.UnicodeChar << 16)),
+                         (INT32)KeyData->KeyState.KeyShiftState);
+    }
+  }
 
-    data->state = LV_INDEV_STATE_PRESSED;
-  } else {
+  return mKeyQueueHead != mKeyQueueTail;
+}
+
+
+/**
+  Repeat rate in repeats per second after a key has been held HeldMs.
+
+  The rate rises from PcdLvglKeyRepeatRate to PcdLvglKeyRepeatMaxRate
+  along a quadratic curve over PcdLvglKeyRepeatRampMs: slow enough at
+  first to stop on a nearby entry, then fast enough to cross a long list.
+**/
+STATIC
+UINT32
+KeyRepeatRate (
+  IN UINT32  HeldMs
+  )
+{
+  UINT32                             MinRate = FixedPcdGet8 (PcdLvglKeyRepeatRate);
+  UINT32                             MaxRate = FixedPcdGet16 (PcdLvglKeyRepeatMaxRate);
+  UINT32                             RampMs = FixedPcdGet16 (PcdLvglKeyRepeatRampMs);
+
+  if (MaxRate <= MinRate || HeldMs >= RampMs) {
+    return LV_MAX (MinRate, MaxRate);
+  }
+
+  return MinRate + (UINT32)DivU64x32 (MultU64x32 ((UINT64)HeldMs * HeldMs, MaxRate - MinRate), RampMs * RampMs);
+}
+
+
+/**
+  Account the repeats of the held key up to Now.
+
+  Time is only credited as far as one repeat interval past the last
+  keystroke from the firmware, which is all that is known about the key
+  still being down: a released key stops after at most one interval worth
+  of repeats. The key counts as released after two intervals without one.
+**/
+STATIC
+VOID
+KeyRepeatAccrue (
+  IN uint32_t  Now
+  )
+{
+  LVGL_UEFI_KEY_REPEAT               *Repeat = &mKeyRepeat;
+  uint32_t                           Until;
+
+  if (Repeat->Interval == 0) {
+    return;
+  }
+
+  Until = Repeat->LastArrival + Repeat->Interval;
+  if ((INT32)(Now - Until) < 0) {
+    Until = Now;
+  }
+  if ((INT32)(Until - Repeat->Credited) > 0) {
+    Repeat->MilliSteps += KeyRepeatRate (Repeat->Credited - Repeat->HoldStart) * (Until - Repeat->Credited);
+    Repeat->Steps = LV_MIN (Repeat->Steps + Repeat->MilliSteps / 1000, LVGL_UEFI_KEY_REPEAT_MAX_STEPS);
+    Repeat->MilliSteps %= 1000;
+    Repeat->Credited = Until;
+  }
+
+  if (Now - Repeat->LastArrival > 2 * Repeat->Interval) {
+    Repeat->Interval = 0;
+  }
+}
+
+
+/**
+  Track a keystroke read from the firmware.
+
+  Navigation keys the firmware repeats faster than every
+  LVGL_UEFI_KEY_REPEAT_STREAM_MS are held: their keystrokes from then on
+  only keep the hold alive, the repeats LVGL sees are synthesised at the
+  accelerated rate instead. Any other keystroke ends the hold.
+
+  @retval TRUE    The keystroke is a repeat of the held key and is consumed.
+**/
+STATIC
+BOOLEAN
+KeyRepeatTrack (
+  IN uint32_t  Key,
+  IN uint32_t  Tick
+  )
+{
+  LVGL_UEFI_KEY_REPEAT               *Repeat = &mKeyRepeat;
+  BOOLEAN                            Repeatable;
+
+  Repeatable = FixedPcdGet16 (PcdLvglKeyRepeatMaxRate) != 0 &&
+               lv_indev_get_group (indev_keypad) != NULL &&
+               (Key == LV_KEY_UP || Key == LV_KEY_DOWN || Key == LV_KEY_LEFT || Key == LV_KEY_RIGHT ||
+                Key == LV_KEY_NEXT || Key == LV_KEY_PREV);
+
+  if (Repeatable && Key == Repeat->Key && Tick - Repeat->LastArrival <= LVGL_UEFI_KEY_REPEAT_STREAM_MS) {
+    if (Repeat->Interval == 0) {
+      Repeat->Interval = LV_MAX (Tick - Repeat->LastArrival, 1);
+      Repeat->HoldStart = Tick;
+      Repeat->Credited = Tick;
+      Repeat->MilliSteps = 0;
+      Repeat->LastArrival = Tick;
+      return FALSE;
+    }
+    Repeat->Interval = LV_MAX ((3 * Repeat->Interval + (Tick - Repeat->LastArrival)) / 4, 1);
+    Repeat->LastArrival = Tick;
+    return TRUE;
+  }
+
+  Repeat->Key = Repeatable ? Key : 0;
+  Repeat->LastArrival = Tick;
+  Repeat->Interval = 0;
+  Repeat->Steps = 0;
+  return FALSE;
+}
+
+
+static void keypad_read(lv_indev_t * indev_drv, lv_indev_data_t * data)
+{
+  uint32_t                           Key;
+  uint32_t                           Tick;
+  UINT64                             Stamp;
+
+  //
+  // Every queued keystroke, and every synthesised repeat, is handed over as
+  // a press and a release in the same read cycle, continue_reading makes
+  // LVGL read again right away. A repeat is a complete press, so LVGL
+  // moves the group focus or sends the key to the focused object for each.
+  //
+  if (mKeyReleasePending) {
+    mKeyReleasePending = FALSE;
+    data->key = mKeyLast;
     data->state = LV_INDEV_STATE_RELEASED;
+    data->continue_reading = mKeyQueueHead != mKeyQueueTail || mKeyRepeat.Steps != 0;
+    return;
+  }
+
+  KeyQueueFill ();
+  while (mKeyQueueHead != mKeyQueueTail) {
+    Key = KeyDataToLvKey (&mKeyQueue[mKeyQueueTail % LVGL_UEFI_KEY_QUEUE_SIZE]);
+    Tick = mKeyQueueTick[mKeyQueueTail % LVGL_UEFI_KEY_QUEUE_SIZE];
+    Stamp = mKeyQueueStamp[mKeyQueueTail % LVGL_UEFI_KEY_QUEUE_SIZE];
+    mKeyQueueTail++;
+    if (Key != 0 && !KeyRepeatTrack (Key, Tick)) {
+      UefiLvglLatencyInput (Stamp);
+      mKeyLast = Key;
+      mKeyReleasePending = TRUE;
+      data->key = Key;
+      data->state = LV_INDEV_STATE_PRESSED;
+      data->continue_reading = true;
+      return;
+    }
   }
 
+  KeyRepeatAccrue (lv_tick_get ());
+  if (mKeyRepeat.Steps != 0) {
+    mKeyRepeat.Steps--;
+    mKeyLast = mKeyRepeat.Key;
+    mKeyReleasePending = TRUE;
+    data->key = mKeyRepeat.Key;
+    data->state = LV_INDEV_STATE_PRESSED;
+    data->continue_reading = true;
+    return;
+  }
+
+  data->key = mKeyLast;
+  data->state = LV_INDEV_STATE_RELEASED;
 }
 
 
@@ -154,163 +472,713 @@ lv_indev_t * lv_uefi_keyboard_create(void)
     lv_indev_set_type(indev, LV_INDEV_TYPE_KEYPAD);
     lv_indev_set_read_cb(indev, keypad_read);
 
+    if (EFI_ERROR (gBS->HandleProtocol (gST->ConsoleInHandle, &gEfiSimpleTextInputExProtocolGuid, (VOID **)&mTxtInEx))) {
+      mTxtInEx = NULL;
+    }
+
     return indev;
 }
 
 
-EFI_STATUS
-EFIAPI
-GetXY (
-  lv_indev_t * indev_drv
+/**
+  Compute the fixed-point factors mapping a device's coordinates to the
+  GOP resolution, so that reading it takes a multiply and no division.
+
+  Absolute pointers map AbsoluteMin..AbsoluteMax to 0..resolution - 1.
+  A simple pointer moved by LVGL_UEFI_POINTER_TRAVEL times its resolution
+  crosses the screen.
+**/
+STATIC
+VOID
+PointerDeviceScale (
+  IN OUT LVGL_UEFI_POINTER_DEVICE  *Device
   )
 {
-  EFI_STATUS                     Status;
-  EFI_ABSOLUTE_POINTER_PROTOCOL  *AbsPointer = NULL;
-  EFI_ABSOLUTE_POINTER_STATE     AbsState;
-  EFI_SIMPLE_POINTER_PROTOCOL    *SimplePointer = NULL;
-  EFI_SIMPLE_POINTER_STATE       SimpleState;
-
-  lv_display_t *disp = lv_indev_get_display(indev_drv);
-
-  int32_t hor_res = lv_display_get_horizontal_resolution(disp);
-  int32_t ver_res = lv_display_get_vertical_resolution(disp);
-
-  if (mLvglUefiMouse.AbsPointer != NULL) {
-    AbsPointer = mLvglUefiMouse.AbsPointer;
-    Status = AbsPointer->GetState (AbsPointer, &AbsState);
-    if (!EFI_ERROR (Status)) {
-      mLvglUefiMouse.LastCursorX = (AbsState.CurrentX * hor_res) / (AbsPointer->Mode->AbsoluteMaxX - AbsPointer->Mode->AbsoluteMinX);
-      if (mLvglUefiMouse.LastCursorX > hor_res - 1) {
-        mLvglUefiMouse.LastCursorX = hor_res - 1;
-      }
-      mLvglUefiMouse.LastCursorY = (AbsState.CurrentY * ver_res) / (AbsPointer->Mode->AbsoluteMaxY - AbsPointer->Mode->AbsoluteMinY);
-      if (mLvglUefiMouse.LastCursorY > ver_res - 1) {
-        mLvglUefiMouse.LastCursorY = ver_res - 1;
-      }
-      mLvglUefiMouse.LeftButton = AbsState.ActiveButtons & BIT0;
+  EFI_ABSOLUTE_POINTER_MODE          *AbsMode;
+  EFI_SIMPLE_POINTER_MODE            *SimpleMode;
+
+  if (Device->AbsPointer != NULL) {
+    AbsMode = Device->AbsPointer->Mode;
+    Device->ScaleX = DivU64x64Remainder (LShiftU64 (mLvglUefiMouse.HorRes - 1, 32),
+                                         AbsMode->AbsoluteMaxX - AbsMode->AbsoluteMinX, NULL);
+    Device->ScaleY = DivU64x64Remainder (LShiftU64 (mLvglUefiMouse.VerRes - 1, 32),
+                                         AbsMode->AbsoluteMaxY - AbsMode->AbsoluteMinY, NULL);
+  } else {
+    SimpleMode = Device->SimplePointer->Mode;
+    Device->ScaleX = DivU64x64Remainder (LShiftU64 (mLvglUefiMouse.HorRes, 32),
+                                         MultU64x32 (LV_MAX (SimpleMode->ResolutionX, 1), LVGL_UEFI_POINTER_TRAVEL), NULL);
+    Device->ScaleY = DivU64x64Remainder (LShiftU64 (mLvglUefiMouse.VerRes, 32),
+                                         MultU64x32 (LV_MAX (SimpleMode->ResolutionY, 1), LVGL_UEFI_POINTER_TRAVEL), NULL);
+  }
+}
+
 
-      return EFI_SUCCESS;
+/**
+  Add the pointer on a handle to the merged devices, preferring its
+  absolute pointer. Handles without a device path are skipped: the console
+  splitter installs virtual pointers on ConsoleInHandle which already merge
+  the real ones.
+**/
+STATIC
+VOID
+PointerDeviceAdd (
+  IN EFI_HANDLE  Handle
+  )
+{
+  LVGL_UEFI_POINTER_DEVICE           *Device;
+  EFI_DEVICE_PATH_PROTOCOL           *DevicePath;
+  EFI_ABSOLUTE_POINTER_PROTOCOL      *AbsPointer;
+  EFI_SIMPLE_POINTER_PROTOCOL        *SimplePointer;
+  UINT32                             Index;
+
+  for (Index = 0; Index < mLvglUefiMouse.DeviceCount; Index++) {
+    if (mLvglUefiMouse.Devices[Index].Handle == Handle) {
+      return;
     }
-  } else if (mLvglUefiMouse.SimplePointer != NULL) {
-    SimplePointer = mLvglUefiMouse.SimplePointer;
-    Status = SimplePointer->GetState (SimplePointer, &SimpleState);
-    if (!EFI_ERROR (Status)) {
-      mLvglUefiMouse.LastCursorX += (SimpleState.RelativeMovementX * hor_res) / (INT32)(50 * SimplePointer->Mode->ResolutionX);
-      if (mLvglUefiMouse.LastCursorX > hor_res - 1) {
-        mLvglUefiMouse.LastCursorX = hor_res - 1;
-      }
-      if (mLvglUefiMouse.LastCursorX < 0) {
-        mLvglUefiMouse.LastCursorX = 0;
-      }
-      mLvglUefiMouse.LastCursorY += (SimpleState.RelativeMovementY * ver_res) / (INT32)(50 * SimplePointer->Mode->ResolutionY);
-      if (mLvglUefiMouse.LastCursorY > ver_res - 1) {
-        mLvglUefiMouse.LastCursorY = ver_res - 1;
-      }
-      if (mLvglUefiMouse.LastCursorY < 0) {
-        mLvglUefiMouse.LastCursorY = 0;
+  }
+  if (mLvglUefiMouse.DeviceCount == LVGL_UEFI_MAX_POINTERS ||
+      EFI_ERROR (gBS->HandleProtocol (Handle, &gEfiDevicePathProtocolGuid, (VOID **)&DevicePath))) {
+    return;
+  }
+
+  Device = &mLvglUefiMouse.Devices[mLvglUefiMouse.DeviceCount];
+  ZeroMem (Device, sizeof (*Device));
+  if (!EFI_ERROR (gBS->HandleProtocol (Handle, &gEfiAbsolutePointerProtocolGuid, (VOID **)&AbsPointer)) &&
+      AbsPointer->Mode != NULL &&
+      AbsPointer->Mode->AbsoluteMaxX > AbsPointer->Mode->AbsoluteMinX &&
+      AbsPointer->Mode->AbsoluteMaxY > AbsPointer->Mode->AbsoluteMinY) {
+    Device->AbsPointer = AbsPointer;
+  } else if (!EFI_ERROR (gBS->HandleProtocol (Handle, &gEfiSimplePointerProtocolGuid, (VOID **)&SimplePointer)) &&
+             SimplePointer->Mode != NULL) {
+    Device->SimplePointer = SimplePointer;
+  } else {
+    return;
+  }
+
+  Device->Handle = Handle;
+  PointerDeviceScale (Device);
+  mLvglUefiMouse.DeviceCount++;
+
+  DebugPrint (DEBUG_INFO, "LVGL input: %a pointer %p added\n", Device->AbsPointer != NULL ? "absolute" : "simple", Handle);
+}
+
+
+/**
+  Add the pointers of every handle with an absolute or simple pointer.
+**/
+STATIC
+VOID
+PointerDevicesScan (
+  VOID
+  )
+{
+  EFI_GUID                           *Guids[2];
+  EFI_HANDLE                         *HandleBuffer;
+  UINTN                              HandleCount, Index, Guid;
+
+  Guids[0] = &gEfiAbsolutePointerProtocolGuid;
+  Guids[1] = &gEfiSimplePointerProtocolGuid;
+  for (Guid = 0; Guid < ARRAY_SIZE (Guids); Guid++) {
+    HandleBuffer = NULL;
+    HandleCount = 0;
+    if (EFI_ERROR (gBS->LocateHandleBuffer (ByProtocol, Guids[Guid], NULL, &HandleCount, &HandleBuffer))) {
+      continue;
+    }
+    for (Index = 0; Index < HandleCount; Index++) {
+      PointerDeviceAdd (HandleBuffer[Index]);
+    }
+    FreePool (HandleBuffer);
+  }
+}
+
+
+/**
+  Bring the merged devices up to date: add pointers installed since the
+  last scan, and drop those whose protocol is gone, before anything calls
+  into them. Must run at TPL_CALLBACK.
+
+  @retval TRUE    A dropped device held a button, the merged state changed.
+**/
+STATIC
+BOOLEAN
+PointerDevicesRefresh (
+  VOID
+  )
+{
+  LVGL_UEFI_POINTER_DEVICE           *Device;
+  VOID                               *Interface;
+  UINT32                             Index;
+  BOOLEAN                            Changed;
+
+  if (mLvglUefiMouse.Rescan) {
+    mLvglUefiMouse.Rescan = FALSE;
+    PointerDevicesScan ();
+  }
+
+  Changed = FALSE;
+  for (Index = 0; Index < mLvglUefiMouse.DeviceCount; Index++) {
+    Device = &mLvglUefiMouse.Devices[Index];
+    if (Device->AbsPointer != NULL) {
+      if (!EFI_ERROR (gBS->HandleProtocol (Device->Handle, &gEfiAbsolutePointerProtocolGuid, &Interface)) &&
+          Interface == Device->AbsPointer) {
+        continue;
       }
+    } else if (!EFI_ERROR (gBS->HandleProtocol (Device->Handle, &gEfiSimplePointerProtocolGuid, &Interface)) &&
+               Interface == Device->SimplePointer) {
+      continue;
+    }
+
+    DebugPrint (DEBUG_INFO, "LVGL input: pointer %p removed\n", Device->Handle);
+    Changed |= Device->LeftButton || Device->RightButton;
+    *Device = mLvglUefiMouse.Devices[--mLvglUefiMouse.DeviceCount];
+    Index--;
+  }
+
+  return Changed;
+}
 
-      mLvglUefiMouse.LeftButton = SimpleState.LeftButton;
-      mLvglUefiMouse.RightButton = SimpleState.RightButton;
 
-      return EFI_SUCCESS;
+/**
+  Read one pointer device into the merged cursor.
+
+  @retval TRUE    The device reported new data.
+**/
+STATIC
+BOOLEAN
+PointerDeviceRead (
+  IN     lv_display_t              *Disp,
+  IN OUT LVGL_UEFI_POINTER_DEVICE  *Device
+  )
+{
+  EFI_ABSOLUTE_POINTER_STATE         AbsState;
+  EFI_ABSOLUTE_POINTER_MODE          *AbsMode;
+  EFI_SIMPLE_POINTER_STATE           SimpleState;
+  lv_point_t                         Motion;
+
+  if (Device->AbsPointer != NULL) {
+    if (EFI_ERROR (Device->AbsPointer->GetState (Device->AbsPointer, &AbsState))) {
+      return FALSE;
     }
+    AbsMode = Device->AbsPointer->Mode;
+    AbsState.CurrentX = LV_CLAMP (AbsMode->AbsoluteMinX, AbsState.CurrentX, AbsMode->AbsoluteMaxX);
+    AbsState.CurrentY = LV_CLAMP (AbsMode->AbsoluteMinY, AbsState.CurrentY, AbsMode->AbsoluteMaxY);
+    mLvglUefiMouse.FixX = (INT64)MultU64x64 (AbsState.CurrentX - AbsMode->AbsoluteMinX, Device->ScaleX);
+    mLvglUefiMouse.FixY = (INT64)MultU64x64 (AbsState.CurrentY - AbsMode->AbsoluteMinY, Device->ScaleY);
+    Device->LeftButton = (AbsState.ActiveButtons & EFI_ABSP_TouchActive) != 0;
+    Device->RightButton = (AbsState.ActiveButtons & EFI_ABS_AltActive) != 0;
+    return TRUE;
+  }
+
+  if (EFI_ERROR (Device->SimplePointer->GetState (Device->SimplePointer, &SimpleState))) {
+    return FALSE;
   }
 
-  return EFI_NOT_READY;
+  //
+  // Mouse movement is relative to what the user sees, which is not the
+  // GOP orientation on a rotated panel. The fraction of a pixel is kept,
+  // so slow movements are not lost.
+  //
+  Motion.x = LV_CLAMP (-0x8000, SimpleState.RelativeMovementX, 0x8000);
+  Motion.y = LV_CLAMP (-0x8000, SimpleState.RelativeMovementY, 0x8000);
+  lv_uefi_disp_rotate_motion (Disp, &Motion);
+
+  mLvglUefiMouse.FixX += MultS64x64 (Motion.x, (INT64)Device->ScaleX);
+  mLvglUefiMouse.FixY += MultS64x64 (Motion.y, (INT64)Device->ScaleY);
+  mLvglUefiMouse.FixX = LV_CLAMP (0, mLvglUefiMouse.FixX, (INT64)LShiftU64 (mLvglUefiMouse.HorRes - 1, 32));
+  mLvglUefiMouse.FixY = LV_CLAMP (0, mLvglUefiMouse.FixY, (INT64)LShiftU64 (mLvglUefiMouse.VerRes - 1, 32));
+  Device->LeftButton = SimpleState.LeftButton;
+  Device->RightButton = SimpleState.RightButton;
+  return TRUE;
 }
 
 
+/**
+  Read every pointer device into one cursor, in GOP coordinates; mouse_read
+  maps it to LVGL. Absolute devices place the cursor, simple ones move it,
+  and a button is down while it is down on any device. Must run at
+  TPL_CALLBACK.
+
+  @retval EFI_SUCCESS     A device reported new data.
+  @retval EFI_NOT_READY   Nothing changed.
+**/
 EFI_STATUS
 EFIAPI
-EfiMouseInit (
+GetXY (
+  lv_indev_t * indev_drv
+  )
+{
+  LVGL_UEFI_POINTER_DEVICE           *Device;
+  lv_display_t                       *Disp;
+  UINT32                             Index;
+  BOOLEAN                            Updated;
+  BOOLEAN                            Left, Right;
+
+  //
+  // A replayed pointer state is queued by the pump, as the sampling timer
+  // would have done.
+  //
+  if (mInputMode == LVGL_INPUT_REPLAY) {
+    InputReplayPump ();
+    return EFI_NOT_READY;
+  }
+
+  Disp = lv_indev_get_display (indev_drv);
+  Updated = PointerDevicesRefresh ();
+  Left = FALSE;
+  Right = FALSE;
+
+  for (Index = 0; Index < mLvglUefiMouse.DeviceCount; Index++) {
+    Device = &mLvglUefiMouse.Devices[Index];
+    Updated |= PointerDeviceRead (Disp, Device);
+    Left |= Device->LeftButton;
+    Right |= Device->RightButton;
+  }
+
+  mLvglUefiMouse.LastCursorX = (INTN)RShiftU64 ((UINT64)mLvglUefiMouse.FixX, 32);
+  mLvglUefiMouse.LastCursorY = (INTN)RShiftU64 ((UINT64)mLvglUefiMouse.FixY, 32);
+  mLvglUefiMouse.LeftButton = Left;
+  mLvglUefiMouse.RightButton = Right;
+
+  return Updated ? EFI_SUCCESS : EFI_NOT_READY;
+}
+
+
+/**
+  Free one slot of the full pointer queue without losing a button state
+  change. Must run at TPL_CALLBACK.
+
+  The oldest motion-only sample is removed. If every queued sample is a
+  transition, the oldest press/release pair goes, which leaves the state
+  LVGL last saw consistent with the next queued transition.
+**/
+STATIC
+VOID
+PointerQueueMakeRoom (
   VOID
   )
 {
-  EFI_STATUS                     Status;
-  EFI_ABSOLUTE_POINTER_PROTOCOL  *AbsPointer = NULL;
-  EFI_SIMPLE_POINTER_PROTOCOL    *SimplePointer = NULL;
-  EFI_HANDLE                     *HandleBuffer = NULL;
-  UINTN                          HandleCount, Index;
-  EFI_DEVICE_PATH_PROTOCOL       *DevicePath;
-  BOOLEAN                        AbsPointerSupport = FALSE;
-  BOOLEAN                        SimplePointerSupport = FALSE;
-
-  HandleCount = 0;
-  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiAbsolutePointerProtocolGuid, NULL, &HandleCount, &HandleBuffer);
-  for (Index = 0; Index < HandleCount; Index++) {
-    Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiDevicePathProtocolGuid, (VOID **)&DevicePath);
-    if (!EFI_ERROR (Status)) {
-      AbsPointerSupport = TRUE;
+  UINT32  Index;
+
+  for (Index = mPointerQueueTail; Index != mPointerQueueHead; Index++) {
+    if (!mPointerQueue[Index % LVGL_UEFI_POINTER_QUEUE_SIZE].Transition) {
       break;
     }
   }
-  if (HandleBuffer!= NULL) {
-    FreePool (HandleBuffer);
-    HandleBuffer = NULL;
+
+  if (Index == mPointerQueueHead) {
+    mPointerQueueTail += 2;
+    return;
   }
 
-  if (AbsPointerSupport) {
-    goto StartInit;
+  for (; Index + 1 != mPointerQueueHead; Index++) {
+    mPointerQueue[Index % LVGL_UEFI_POINTER_QUEUE_SIZE] =
+      mPointerQueue[(Index + 1) % LVGL_UEFI_POINTER_QUEUE_SIZE];
   }
 
-  HandleCount = 0;
-  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiSimplePointerProtocolGuid, NULL, &HandleCount, &HandleBuffer);
-  for (Index = 0; Index < HandleCount; Index++) {
-    Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiDevicePathProtocolGuid, (VOID **)&DevicePath);
-    if (!EFI_ERROR (Status)) {
-      SimplePointerSupport = TRUE;
-      break;
+  mPointerQueueHead--;
+}
+
+
+/**
+  Queue the pointer state GetXY just read. Must run at TPL_CALLBACK.
+
+  Motion is coalesced into the last queued sample as long as that one is
+  motion too, button transitions always get their own entry, so LVGL sees
+  every press and release where it happened. A full queue drops motion,
+  never a transition.
+**/
+STATIC
+VOID
+PointerQueuePush (
+  VOID
+  )
+{
+  LVGL_UEFI_POINTER_SAMPLE  *Last;
+  BOOLEAN                   Pressed;
+  BOOLEAN                   Transition;
+
+  Pressed = mLvglUefiMouse.LeftButton;
+  Transition = Pressed != mPointerLastPressed;
+  mPointerLastPressed = Pressed;
+
+  if (mInputMode == LVGL_INPUT_RECORD) {
+    InputRecordAppend (LVGL_UEFI_INPUT_POINTER, Pressed, 0,
+                       (INT32)mLvglUefiMouse.LastCursorX, (INT32)mLvglUefiMouse.LastCursorY);
+  }
+
+  Last = &mPointerQueue[(mPointerQueueHead - 1) % LVGL_UEFI_POINTER_QUEUE_SIZE];
+  if (mPointerQueueHead != mPointerQueueTail && !Transition && !Last->Transition) {
+    Last->X = mLvglUefiMouse.LastCursorX;
+    Last->Y = mLvglUefiMouse.LastCursorY;
+    return;
+  }
+
+  if (mPointerQueueHead - mPointerQueueTail == LVGL_UEFI_POINTER_QUEUE_SIZE) {
+    //
+    // Full. Motion can go, the position is read again once the queue
+    // drains, a transition makes room instead.
+    //
+    if (!Transition) {
+      return;
     }
+
+    PointerQueueMakeRoom ();
   }
-  if (HandleBuffer!= NULL) {
-    FreePool (HandleBuffer);
-    HandleBuffer = NULL;
+
+  Last = &mPointerQueue[mPointerQueueHead % LVGL_UEFI_POINTER_QUEUE_SIZE];
+  Last->X = mLvglUefiMouse.LastCursorX;
+  Last->Y = mLvglUefiMouse.LastCursorY;
+  Last->Pressed = Pressed;
+  Last->Transition = Transition;
+  Last->Stamp = GetPerformanceCounter ();
+  mPointerQueueHead++;
+}
+
+
+/**
+  Open the input log, PcdLvglInputLogPath on the volume the image was
+  loaded from.
+**/
+STATIC
+EFI_STATUS
+InputLogOpen (
+  IN  UINT64             OpenMode,
+  OUT EFI_FILE_PROTOCOL  **File
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_LOADED_IMAGE_PROTOCOL        *LoadedImage;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem;
+  EFI_FILE_PROTOCOL                *Root;
+
+  Status = gBS->HandleProtocol (gImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = gBS->HandleProtocol (LoadedImage->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&FileSystem);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = FileSystem->OpenVolume (FileSystem, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
-  if (!AbsPointerSupport && !SimplePointerSupport) {
-    return EFI_UNSUPPORTED;
+  Status = Root->Open (Root, File, (CHAR16 *)FixedPcdGetPtr (PcdLvglInputLogPath), OpenMode, 0);
+  Root->Close (Root);
+  return Status;
+}
+
+
+/**
+  Read the input log into memory.
+
+  The log is a LVGL_UEFI_INPUT_LOG_HEADER followed by LVGL_UEFI_INPUT_RECORD
+  entries in tick order: every keystroke read from the firmware and every
+  merged pointer state queued for LVGL, as they were seen while recording.
+**/
+STATIC
+EFI_STATUS
+InputLogLoad (
+  VOID
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_FILE_PROTOCOL            *File;
+  LVGL_UEFI_INPUT_LOG_HEADER   Header;
+  UINT64                       FileSize;
+  UINTN                        Size;
+
+  Status = InputLogOpen (EFI_FILE_MODE_READ, &File);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
-StartInit:
-  DebugPrint (DEBUG_INFO, "EfiMouseInit()\n");
+  File->SetPosition (File, MAX_UINT64);
+  File->GetPosition (File, &FileSize);
+  File->SetPosition (File, 0);
 
-  DebugPrint (DEBUG_INFO, "Abs Pointer: %d\n", AbsPointerSupport);
-  DebugPrint (DEBUG_INFO, "Simple Pointer: %d\n", SimplePointerSupport);
+  Size = sizeof (Header);
+  Status = File->Read (File, &Size, &Header);
+  if (!EFI_ERROR (Status) &&
+      (Size != sizeof (Header) || Header.Signature != LVGL_UEFI_INPUT_LOG_SIGNATURE ||
+       FileSize < sizeof (Header) + MultU64x32 (Header.Count, sizeof (LVGL_UEFI_INPUT_RECORD)))) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
 
-  mLvglUefiMouse.AbsPointer = NULL;
-  if (AbsPointerSupport) {
-    Status = gBS->HandleProtocol (gST->ConsoleInHandle, &gEfiAbsolutePointerProtocolGuid, (VOID **)&AbsPointer);
-    if (!EFI_ERROR (Status) && AbsPointer != NULL) {
-      // AbsPointer->Reset(AbsPointer, TRUE);
-      mLvglUefiMouse.AbsPointer = AbsPointer;
+  if (!EFI_ERROR (Status) && Header.Count != 0) {
+    Size = Header.Count * sizeof (LVGL_UEFI_INPUT_RECORD);
+    mInputLog = AllocatePool (Size);
+    if (mInputLog == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Status = File->Read (File, &Size, mInputLog);
     }
   }
+  File->Close (File);
 
-  mLvglUefiMouse.SimplePointer = NULL;
-  if (SimplePointerSupport && !AbsPointerSupport) {
-    Status = gBS->HandleProtocol (gST->ConsoleInHandle, &gEfiSimplePointerProtocolGuid, (VOID **)&SimplePointer);
-    if (!EFI_ERROR (Status) && SimplePointer != NULL) {
-      // SimplePointer->Reset(SimplePointer, TRUE);
-      mLvglUefiMouse.SimplePointer = SimplePointer;
+  if (EFI_ERROR (Status)) {
+    if (mInputLog != NULL) {
+      FreePool (mInputLog);
+      mInputLog = NULL;
     }
+    return Status;
   }
 
-  mLvglUefiMouse.ActiveButtons = 0;
-  mLvglUefiMouse.LeftButton = FALSE;
-  mLvglUefiMouse.RightButton = FALSE;
+  mInputLogCount = Header.Count;
+  mInputLogSize = Header.Count;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Write the recorded input to the input log, replacing an older one.
+**/
+STATIC
+EFI_STATUS
+InputLogSave (
+  VOID
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_FILE_PROTOCOL            *File;
+  LVGL_UEFI_INPUT_LOG_HEADER   Header;
+  UINTN                        Size;
 
+  if (!EFI_ERROR (InputLogOpen (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, &File))) {
+    File->Delete (File);
+  }
+  Status = InputLogOpen (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, &File);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Header.Signature = LVGL_UEFI_INPUT_LOG_SIGNATURE;
+  Header.Count = mInputLogCount;
+  Size = sizeof (Header);
+  Status = File->Write (File, &Size, &Header);
+  if (!EFI_ERROR (Status) && mInputLogCount != 0) {
+    Size = mInputLogCount * sizeof (LVGL_UEFI_INPUT_RECORD);
+    Status = File->Write (File, &Size, mInputLog);
+  }
+  File->Close (File);
   return Status;
 }
 
 
+/**
+  Append one input to the recording. Pointer states are recorded from the
+  sampling timer, so the log is only touched at TPL_CALLBACK.
+**/
+STATIC
+VOID
+InputRecordAppend (
+  IN UINT8   Type,
+  IN UINT8   Pressed,
+  IN UINT16  Toggle,
+  IN INT32   X,
+  IN INT32   Y
+  )
+{
+  EFI_TPL                  OldTpl;
+  LVGL_UEFI_INPUT_RECORD   *Grown;
+  LVGL_UEFI_INPUT_RECORD   *Record;
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  if (mInputLogCount == mInputLogSize) {
+    Grown = ReallocatePool (mInputLogSize * sizeof (LVGL_UEFI_INPUT_RECORD),
+                            (mInputLogSize * 2 + LVGL_UEFI_INPUT_LOG_GROW) * sizeof (LVGL_UEFI_INPUT_RECORD),
+                            mInputLog);
+    if (Grown == NULL) {
+      gBS->RestoreTPL (OldTpl);
+      return;
+    }
+    mInputLog = Grown;
+    mInputLogSize = mInputLogSize * 2 + LVGL_UEFI_INPUT_LOG_GROW;
+  }
+
+  Record = &mInputLog[mInputLogCount++];
+  Record->Tick = lv_tick_elaps (mInputLogStart);
+  Record->Type = Type;
+  Record->Pressed = Pressed;
+  Record->Toggle = Toggle;
+  Record->X = X;
+  Record->Y = Y;
+  gBS->RestoreTPL (OldTpl);
+}
+
+
+/**
+  Hand the recorded inputs that are due by the LVGL tick to the key and
+  pointer queues, in place of the firmware. Keystrokes wait in the log
+  while the key queue is full, and the pointer records behind them too,
+  so the order is kept.
+**/
+STATIC
+VOID
+InputReplayPump (
+  VOID
+  )
+{
+  LVGL_UEFI_INPUT_RECORD   *Record;
+  EFI_KEY_DATA             *KeyData;
+  uint32_t                 Now;
+
+  Now = lv_tick_elaps (mInputLogStart);
+  while (mInputLogNext < mInputLogCount) {
+    Record = &mInputLog[mInputLogNext];
+    if (Record->Tick > Now) {
+      break;
+    }
+
+    if (Record->Type == LVGL_UEFI_INPUT_KEY) {
+      if (mKeyQueueHead - mKeyQueueTail == LVGL_UEFI_KEY_QUEUE_SIZE) {
+        break;
+      }
+      KeyData = &mKeyQueue[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE];
+      KeyData->Key.ScanCode = (UINT16)Record->X;
+      KeyData->Key.UnicodeChar = (CHAR16)((UINT32)Record->X >> 16);
+      KeyData->KeyState.KeyShiftState = (UINT32)Record->Y;
+      KeyData->KeyState.KeyToggleState = (EFI_KEY_TOGGLE_STATE)Record->Toggle;
+      mKeyQueueTick[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE] = lv_tick_get ();
+      mKeyQueueStamp[mKeyQueueHead % LVGL_UEFI_KEY_QUEUE_SIZE] = GetPerformanceCounter ();
+      mKeyQueueHead++;
+    } else if (indev_mouse != NULL) {
+      mLvglUefiMouse.LastCursorX = LV_CLAMP (0, Record->X, mLvglUefiMouse.HorRes - 1);
+      mLvglUefiMouse.LastCursorY = LV_CLAMP (0, Record->Y, mLvglUefiMouse.VerRes - 1);
+      mLvglUefiMouse.FixX = (INT64)LShiftU64 (mLvglUefiMouse.LastCursorX, 32);
+      mLvglUefiMouse.FixY = (INT64)LShiftU64 (mLvglUefiMouse.LastCursorY, 32);
+      mLvglUefiMouse.LeftButton = Record->Pressed != 0;
+      PointerQueuePush ();
+    }
+    mInputLogNext++;
+  }
+}
+
+
+/**
+  Sample the pointer between LVGL reads. The timer is cancelled once the
+  pointer has been still and released for LVGL_UEFI_POINTER_IDLE_SAMPLES
+  samples; mouse_read starts it again when the pointer moves.
+**/
+STATIC
+VOID
+EFIAPI
+PointerSampleNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  if (GetXY ((lv_indev_t *)Context) == EFI_SUCCESS) {
+    PointerQueuePush ();
+    mPointerIdle = 0;
+  } else if (!mLvglUefiMouse.LeftButton && ++mPointerIdle >= LVGL_UEFI_POINTER_IDLE_SAMPLES) {
+    gBS->SetTimer (mPointerTimer, TimerCancel, 0);
+    mPointerSampling = FALSE;
+  }
+}
+
+
+/**
+  Flag a rescan of the pointer devices when a pointer protocol is installed.
+**/
+STATIC
+VOID
+EFIAPI
+PointerProtocolNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  mLvglUefiMouse.Rescan = TRUE;
+}
+
+
+/**
+  Find the pointer devices and watch for new ones.
+
+  @param  Disp    Display whose GOP resolution the devices are scaled to.
+
+  @retval EFI_SUCCESS       At least one pointer device was found.
+  @retval EFI_UNSUPPORTED   No pointer device.
+**/
+EFI_STATUS
+EFIAPI
+EfiMouseInit (
+  IN lv_display_t  *Disp
+  )
+{
+  EFI_STATUS                     Status;
+
+  ZeroMem (&mLvglUefiMouse, sizeof (mLvglUefiMouse));
+  lv_uefi_disp_get_native_resolution (Disp, &mLvglUefiMouse.HorRes, &mLvglUefiMouse.VerRes);
+
+  PointerDevicesScan ();
+  if (mLvglUefiMouse.DeviceCount == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  DebugPrint (DEBUG_INFO, "EfiMouseInit(): %d pointer devices\n", mLvglUefiMouse.DeviceCount);
+
+  //
+  // Pointers plugged in later are added at the next read. Removed ones are
+  // noticed there too, before their protocol is called.
+  //
+  Status = gBS->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, PointerProtocolNotify, NULL, &mLvglUefiMouse.AbsNotify);
+  if (!EFI_ERROR (Status)) {
+    gBS->RegisterProtocolNotify (&gEfiAbsolutePointerProtocolGuid, mLvglUefiMouse.AbsNotify, &mLvglUefiMouse.AbsRegistration);
+  } else {
+    mLvglUefiMouse.AbsNotify = NULL;
+  }
+  Status = gBS->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, PointerProtocolNotify, NULL, &mLvglUefiMouse.SimpleNotify);
+  if (!EFI_ERROR (Status)) {
+    gBS->RegisterProtocolNotify (&gEfiSimplePointerProtocolGuid, mLvglUefiMouse.SimpleNotify, &mLvglUefiMouse.SimpleRegistration);
+  } else {
+    mLvglUefiMouse.SimpleNotify = NULL;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 static void mouse_read(lv_indev_t * indev_drv, lv_indev_data_t * data)
 {
+  EFI_TPL                        OldTpl;
+  LVGL_UEFI_POINTER_SAMPLE       Sample;
+
+  //
+  // Hand the queued samples to LVGL in order, one per continue_reading
+  // round, then the current state.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  if (GetXY(indev_drv) == EFI_SUCCESS) {
+    PointerQueuePush ();
+    if (!mPointerSampling && mPointerTimer != NULL) {
+      mPointerIdle = 0;
+      mPointerSampling = !EFI_ERROR (gBS->SetTimer (mPointerTimer, TimerPeriodic,
+                                                    EFI_TIMER_PERIOD_MILLISECONDS (LVGL_UEFI_POINTER_SAMPLE_MS)));
+    }
+  }
 
-  GetXY(indev_drv);
-  data->point.x = mLvglUefiMouse.LastCursorX;
-  data->point.y = mLvglUefiMouse.LastCursorY;
-  if (mLvglUefiMouse.LeftButton) {
+  if (mPointerQueueHead != mPointerQueueTail) {
+    Sample = mPointerQueue[mPointerQueueTail % LVGL_UEFI_POINTER_QUEUE_SIZE];
+    mPointerQueueTail++;
+    UefiLvglLatencyInput (Sample.Stamp);
+  } else {
+    Sample.X = mLvglUefiMouse.LastCursorX;
+    Sample.Y = mLvglUefiMouse.LastCursorY;
+    Sample.Pressed = mLvglUefiMouse.LeftButton;
+  }
+  data->continue_reading = mPointerQueueHead != mPointerQueueTail;
+  gBS->RestoreTPL (OldTpl);
+
+  data->point.x = Sample.X;
+  data->point.y = Sample.Y;
+  lv_uefi_disp_native_to_logical(lv_indev_get_display(indev_drv), &data->point);
+  if (mCursorOverlay && !data->continue_reading) {
+    lv_uefi_disp_move_cursor(lv_indev_get_display(indev_drv), &data->point);
+  }
+  if (Sample.Pressed) {
     data->state = LV_INDEV_STATE_PRESSED;
   } else {
     data->state = LV_INDEV_STATE_RELEASED;
@@ -325,13 +1193,19 @@ void lv_indev_set_cusor_start(lv_indev_t * indev)
 
     lv_display_t *disp = lv_indev_get_display(indev);
 
-    int32_t hor_res = lv_display_get_horizontal_resolution(disp);
-    int32_t ver_res = lv_display_get_vertical_resolution(disp);
+    int32_t hor_res, ver_res;
+    lv_uefi_disp_get_native_resolution(disp, &hor_res, &ver_res);
 
-    indev->pointer.act_point.x = hor_res / 2;
-    indev->pointer.act_point.y = ver_res / 2;
     mLvglUefiMouse.LastCursorX = hor_res / 2;
     mLvglUefiMouse.LastCursorY = ver_res / 2;
+    mLvglUefiMouse.FixX = (INT64)LShiftU64 (hor_res / 2, 32);
+    mLvglUefiMouse.FixY = (INT64)LShiftU64 (ver_res / 2, 32);
+    indev->pointer.act_point.x = hor_res / 2;
+    indev->pointer.act_point.y = ver_res / 2;
+    lv_uefi_disp_native_to_logical(disp, &indev->pointer.act_point);
+    if (mCursorOverlay) {
+      lv_uefi_disp_move_cursor(disp, &indev->pointer.act_point);
+    }
     mLvglUefiMouse.ActiveButtons = 0;
     mLvglUefiMouse.LeftButton = FALSE;
     mLvglUefiMouse.RightButton = FALSE;
@@ -349,11 +1223,22 @@ lv_indev_t * lv_uefi_mouse_create(lv_display_t * disp)
     lv_indev_set_read_cb(indev, mouse_read);
     lv_indev_set_display (indev, disp);
 
+    //
+    // The display composites the cursor over the flushed frame, so moving it
+    // redraws nothing. Only when it cannot, the cursor is an LVGL image.
+    //
     LV_IMG_DECLARE(mouse_cursor_icon);
-    lv_obj_t * mouse_cursor = lv_image_create(lv_screen_active());
-    lv_image_set_src(mouse_cursor, &mouse_cursor_icon);
+    mCursorOverlay = lv_uefi_disp_set_cursor(disp, &mouse_cursor_icon);
     lv_indev_set_cusor_start(indev);
-    lv_indev_set_cursor(indev, mouse_cursor);
+    if (!mCursorOverlay) {
+      lv_obj_t * mouse_cursor = lv_image_create(lv_screen_active());
+      lv_image_set_src(mouse_cursor, &mouse_cursor_icon);
+      lv_indev_set_cursor(indev, mouse_cursor);
+    }
+
+    if (EFI_ERROR (gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, PointerSampleNotify, indev, &mPointerTimer))) {
+      mPointerTimer = NULL;
+    }
 
     return indev;
 }
@@ -367,29 +1252,162 @@ void lv_port_indev_init(lv_display_t * disp)
      * Mouse
      * -----------------*/
 
+    mInputMode = FixedPcdGet8 (PcdLvglInputMode);
+    if (mInputMode == LVGL_INPUT_REPLAY) {
+      if (EFI_ERROR (InputLogLoad ())) {
+        DebugPrint (DEBUG_ERROR, "LVGL: no input log to replay, using live input\n");
+        mInputMode = LVGL_INPUT_LIVE;
+      } else {
+        DebugPrint (DEBUG_INFO, "LVGL: replaying %d input records\n", mInputLogCount);
+      }
+    }
+    mInputLogStart = lv_tick_get ();
+
     /*Initialize your mouse if you have*/
-    if (EfiMouseInit() == EFI_SUCCESS) {
+    if (EfiMouseInit(disp) == EFI_SUCCESS || mInputMode == LVGL_INPUT_REPLAY) {
       DebugPrint (DEBUG_INFO, "Create Mouse\n");
-      lv_uefi_mouse_create(disp);
+      indev_mouse = lv_uefi_mouse_create(disp);
     }
 
 
     /*------------------
      * Keypad
      * -----------------*/
-    lv_uefi_keyboard_create();
+    indev_keypad = lv_uefi_keyboard_create();
 
 }
 
+/**
+ * Get the events signalled when an input device has new data, so that the
+ * main loop can sleep until input arrives and then read the device at once.
+ * Pointer devices come and go, so get the events again before every wait.
+ * @param events    receives up to `max` events
+ * @param indevs    receives the input device of every event
+ * @param max       size of `events` and `indevs`
+ * @return          number of events stored
+ */
+UINTN lv_port_indev_get_wait_events(EFI_EVENT * events, lv_indev_t ** indevs, UINTN max)
+{
+  UINTN                              Count = 0;
+  UINT32                             Index;
+  EFI_TPL                            OldTpl;
+  LVGL_UEFI_POINTER_DEVICE           *Device;
+
+  if (indev_keypad != NULL && Count < max) {
+    events[Count] = mTxtInEx != NULL ? mTxtInEx->WaitForKeyEx : gST->ConIn->WaitForKey;
+    indevs[Count++] = indev_keypad;
+  }
+
+  if (indev_mouse != NULL) {
+    OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+    PointerDevicesRefresh ();
+    for (Index = 0; Index < mLvglUefiMouse.DeviceCount && Count < max; Index++) {
+      Device = &mLvglUefiMouse.Devices[Index];
+      events[Count] = Device->AbsPointer != NULL ? Device->AbsPointer->WaitForInput : Device->SimplePointer->WaitForInput;
+      indevs[Count++] = indev_mouse;
+    }
+    gBS->RestoreTPL (OldTpl);
+  }
+
+  return Count;
+}
+
+/**
+ * Read pending keystrokes into the port's queue without handing them to
+ * LVGL. The frame budget scheduler calls it between the flushes of a
+ * refresh over the budget, when LVGL cannot process input, so that no
+ * keystroke waits in (or overflows) the firmware buffer until the refresh
+ * is over. The main loop calls it before it waits, since the queued
+ * keystrokes no longer signal WaitForKeyEx.
+ * @return  true if input is queued for the next keypad read, including
+ *          synthesised repeats of a held key that are due
+ */
+bool lv_port_indev_poll(void)
+{
+  BOOLEAN                            Queued;
+
+  if (indev_keypad == NULL) {
+    return false;
+  }
+
+  //
+  // Keystrokes still queued may be repeats that keep the hold alive, only
+  // judge the hold once keypad_read() has tracked them.
+  //
+  Queued = KeyQueueFill ();
+  if (!Queued) {
+    KeyRepeatAccrue (lv_tick_get ());
+  }
+
+  return Queued || mKeyRepeat.Steps != 0;
+}
+
+/**
+ * Check whether input comes from the input log rather than the firmware.
+ */
+bool lv_port_indev_replaying(void)
+{
+  return mInputMode == LVGL_INPUT_REPLAY;
+}
+
+/**
+ * Check whether every record of the input log was handed to the input queues.
+ */
+bool lv_port_indev_replay_done(void)
+{
+  return mInputMode != LVGL_INPUT_REPLAY || mInputLogNext == mInputLogCount;
+}
+
+/**
+ * Get the keypad input device, NULL before lv_port_indev_init().
+ */
+lv_indev_t * lv_port_indev_get_keypad(void)
+{
+  return indev_keypad;
+}
+
 void lv_port_indev_close()
 {
+  EFI_STATUS                         Status;
 
-  mLvglUefiMouse.AbsPointer = NULL;
-  mLvglUefiMouse.SimplePointer = NULL;
-  mLvglUefiMouse.LastCursorX = 0;
-  mLvglUefiMouse.LastCursorY = 0;
-  mLvglUefiMouse.ActiveButtons = 0;
-  mLvglUefiMouse.LeftButton = FALSE;
-  mLvglUefiMouse.RightButton = FALSE;
+  if (mPointerTimer != NULL) {
+    gBS->CloseEvent (mPointerTimer);
+    mPointerTimer = NULL;
+  }
+  mPointerSampling = FALSE;
+  mPointerQueueHead = 0;
+  mPointerQueueTail = 0;
+  mPointerLastPressed = FALSE;
+  mCursorOverlay = FALSE;
+
+  if (mInputMode == LVGL_INPUT_RECORD) {
+    Status = InputLogSave ();
+    DebugPrint (EFI_ERROR (Status) ? DEBUG_ERROR : DEBUG_INFO, "LVGL: %d input records saved - %r\n",
+                mInputLogCount, Status);
+  }
+  if (mInputLog != NULL) {
+    FreePool (mInputLog);
+  }
+  mInputLog = NULL;
+  mInputLogCount = 0;
+  mInputLogSize = 0;
+  mInputLogNext = 0;
+  mInputMode = LVGL_INPUT_LIVE;
+
+  mTxtInEx = NULL;
+  mKeyQueueHead = 0;
+  mKeyQueueTail = 0;
+  mKeyReleasePending = FALSE;
+  ZeroMem (&mKeyRepeat, sizeof (mKeyRepeat));
+  indev_mouse = NULL;
+  indev_keypad = NULL;
+
+  if (mLvglUefiMouse.AbsNotify != NULL) {
+    gBS->CloseEvent (mLvglUefiMouse.AbsNotify);
+  }
+  if (mLvglUefiMouse.SimpleNotify != NULL) {
+    gBS->CloseEvent (mLvglUefiMouse.SimpleNotify);
+  }
+  ZeroMem (&mLvglUefiMouse, sizeof (mLvglUefiMouse));
 }
 
@@ -1,9 +1,88 @@
 #include "LvglLibCommon.h"
+#include "lv_uefi_pixel.h"
+
+#include <Library/LvglLib.h>
+
+/* Dirty areas collected for one direct mode refresh, same as LVGL's invalidation buffer */
+#define UEFI_DISP_MAX_PENDING   32
+
+/* GOP instances the display is mirrored to */
+#define UEFI_DISP_MAX_OUTPUTS   4
+
+/* Native lines upscaled per staging strip when rendering below the GOP resolution */
+#define UEFI_DISP_SCALE_LINES   32
+
+/* Rotated lines per staging strip when the panel is mounted rotated */
+#define UEFI_DISP_ROTATE_LINES  32
+
+/* Edge of the tiles compared against the shadow of the last presented frame */
+#define UEFI_DISP_TILE_SIZE     64
+
+/* Buffers of the display, accounted apart from LVGL objects */
+#define uefi_disp_malloc(size)  LvglUefiHeapAlloc(LvglMemoryDisplay, size)
+#define uefi_disp_free(ptr)     LvglUefiHeapFree(LvglMemoryDisplay, ptr)
 
 
+typedef struct {
+    UINTN                        buffer_bytes;      /* pool held by the render buffers */
+    UINT32                       frames;            /* completed refreshes */
+    UINT32                       flush_calls;       /* flush_cb invocations (one per area or band) */
+    UINT64                       frame_start;       /* performance counter at LV_EVENT_REFR_START */
+    UINT64                       frame_ns_total;
+    UINT64                       frame_ns_max;
+    UINT32                       blt_calls;         /* rectangles submitted to the output */
+    UINT32                       blt_calls_saved;   /* dirty areas folded into another rectangle */
+    INT64                        bytes_saved;       /* overlap avoided minus slack added */
+    UINT32                       tiles_checked;     /* tile diff: tiles compared with the shadow */
+    UINT32                       tiles_skipped;     /* tile diff: tiles identical to the shadow */
+    UINT64                       tile_bytes_skipped;
+    UINT32                       cursor_moves;      /* overlay moves, each a restore and a draw */
+} uefi_disp_stats_t;
+
 typedef struct {
     EFI_GRAPHICS_OUTPUT_PROTOCOL *EfiGop;
+    UINT32                       hor_res;           /* GOP mode resolution */
+    UINT32                       ver_res;
+    lv_uefi_disp_backend_t       backend;
+    UINT8                        *frame_buffer;     /* linear framebuffer, NULL for Blt */
+    UINTN                        fb_stride;         /* PixelsPerScanLine in bytes */
+    lv_uefi_pixel_format_t       fb_format;
+    lv_uefi_pixel_convert_t      convert;           /* lv_color32_t line -> framebuffer line */
+    BOOLEAN                      fb_clean;          /* cached and not coherent: clean written lines */
+    UINT32                       *x_map;            /* native -> rotated LVGL column, NULL when not scaling */
+    UINT32                       *y_map;            /* native -> rotated LVGL line */
+    UINT32                       *staging;          /* UEFI_DISP_SCALE_LINES scaled lines */
+} uefi_disp_output_t;
+
+typedef struct {
+    const lv_image_dsc_t         *icon;             /* ARGB8888, NULL when LVGL draws the cursor itself */
+    lv_point_t                   pos;               /* top left corner, LVGL coordinates */
+    lv_area_t                    area;              /* icon at pos, clipped to the display */
+    BOOLEAN                      visible;           /* area is not empty */
+    BOOLEAN                      drawn;             /* the screen shows the cursor at area */
+    UINT32                       *save_under;       /* rendered pixels below the icon, icon size */
+    UINT32                       *composed;         /* save_under with the icon blended on top */
+    const UINT8                  *frame;            /* last complete frame, fills save_under on a move */
+    UINTN                        frame_stride;
+} uefi_disp_cursor_t;
+
+typedef struct {
+    uefi_disp_output_t           outputs[UEFI_DISP_MAX_OUTPUTS];  /* [0] is the primary, pointer input maps to it */
+    UINT32                       output_cnt;
+    int32_t                      hor_res;           /* LVGL resolution */
+    int32_t                      ver_res;
+    lv_display_rotation_t        rotation;          /* clockwise, LVGL -> screen */
+    int32_t                      scr_hor_res;       /* LVGL resolution after rotation */
+    int32_t                      scr_ver_res;
+    UINT32                       *rotated;          /* UEFI_DISP_ROTATE_LINES rotated lines */
+    UINT32                       *shadow;           /* last presented frame, NULL without tile diff */
+    lv_display_render_mode_t     render_mode;
     uint8_t                      *buffer[2];
+    uint32_t                     merge_slack;
+    lv_area_t                    pending[UEFI_DISP_MAX_PENDING];
+    uint32_t                     pending_cnt;
+    uefi_disp_cursor_t           cursor;
+    uefi_disp_stats_t            stats;
 } uefi_disp_data_t;
 
 
@@ -11,51 +90,1051 @@ static void uefi_disp_delete_evt_cb(lv_event_t * e)
 {
     lv_display_t * disp = lv_event_get_user_data(e);
     uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    uefi_disp_stats_t * stats = &uefi_disp_data->stats;
+    UINT32 Index;
 
-    free(uefi_disp_data->buffer[0]);
-    free(uefi_disp_data->buffer[1]);
+    DebugPrint (DEBUG_INFO, "LVGL display: %a mode, %d KB buffers, %d frames, %d flushes\n",
+                uefi_disp_data->render_mode == LV_DISPLAY_RENDER_MODE_PARTIAL ? "partial" : "direct",
+                (UINT32)(stats->buffer_bytes / 1024), stats->frames, stats->flush_calls);
+    if (stats->frames != 0) {
+      DebugPrint (DEBUG_INFO, "LVGL display: frame time avg %ld us, max %ld us\n",
+                  DivU64x32 (stats->frame_ns_total, stats->frames) / 1000, stats->frame_ns_max / 1000);
+    }
+    DebugPrint (DEBUG_INFO, "LVGL display: %d Blt calls, %d saved by coalescing, %ld bytes saved\n",
+                stats->blt_calls, stats->blt_calls_saved, stats->bytes_saved);
+    if (uefi_disp_data->shadow != NULL) {
+      DebugPrint (DEBUG_INFO, "LVGL display: %d of %d tiles unchanged, %ld bytes skipped\n",
+                  stats->tiles_skipped, stats->tiles_checked, stats->tile_bytes_skipped);
+    }
+    if (uefi_disp_data->cursor.icon != NULL) {
+      DebugPrint (DEBUG_INFO, "LVGL display: %d cursor moves without a redraw\n", stats->cursor_moves);
+    }
+
+    uefi_disp_free(uefi_disp_data->buffer[0]);
+    uefi_disp_free(uefi_disp_data->buffer[1]);
+    for (Index = 0; Index < uefi_disp_data->output_cnt; Index++) {
+        uefi_disp_free(uefi_disp_data->outputs[Index].x_map);
+        uefi_disp_free(uefi_disp_data->outputs[Index].y_map);
+        uefi_disp_free(uefi_disp_data->outputs[Index].staging);
+    }
+    uefi_disp_free(uefi_disp_data->rotated);
+    uefi_disp_free(uefi_disp_data->shadow);
+    uefi_disp_free(uefi_disp_data->cursor.save_under);
+    uefi_disp_free(uefi_disp_data->cursor.composed);
 
     lv_free(uefi_disp_data);
 }
 
 
-void uefi_disp_flush(lv_display_t * disp, const lv_area_t * area, lv_color32_t * color32_p)
+static void uefi_disp_refr_evt_cb(lv_event_t * e)
+{
+    lv_display_t * disp = lv_event_get_user_data(e);
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    uefi_disp_stats_t * stats = &uefi_disp_data->stats;
+    UINT64 ns;
+
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+      stats->frame_start = GetPerformanceCounter ();
+      return;
+    }
+
+    if (stats->frame_start == 0) {
+      return;
+    }
+
+    ns = GetTimeInNanoSecond (GetPerformanceCounter () - stats->frame_start);
+    stats->frame_start = 0;
+    stats->frames++;
+    stats->frame_ns_total += ns;
+    if (ns > stats->frame_ns_max) {
+      stats->frame_ns_max = ns;
+    }
+}
+
+
+/**
+  Make framebuffer writes to an area visible to scanout.
+
+  A cached framebuffer that scanout does not snoop needs the written
+  lines cleaned to memory. Only the lines of the area are cleaned, not
+  the whole buffer. Write-combined and uncached mappings only need
+  their pending writes drained.
+**/
+static void uefi_disp_fb_sync(uefi_disp_output_t * Output, const lv_area_t * Area)
+{
+  UINT8                              *Line;
+  UINTN                              Bytes;
+  INT32                              Y;
+
+  if (Output->fb_clean) {
+    Line = Output->frame_buffer + Area->y1 * Output->fb_stride + Area->x1 * Output->fb_format.bytes_per_pixel;
+    Bytes = (Area->x2 - Area->x1 + 1) * Output->fb_format.bytes_per_pixel;
+    for (Y = Area->y1; Y <= Area->y2; Y++) {
+      WriteBackDataCacheRange (Line, Bytes);
+      Line += Output->fb_stride;
+    }
+  }
+
+  MemoryFence ();
+}
+
+
+/**
+  Put one rendered area on the screen.
+
+  @param  Output      Output to draw to.
+  @param  Area        Destination rectangle in screen coordinates.
+  @param  Src         First pixel of the area in the source buffer.
+  @param  SrcStride   Source line length in bytes.
+**/
+static void uefi_disp_output_area(uefi_disp_output_t * Output, const lv_area_t * Area, const UINT8 * Src, UINTN SrcStride)
 {
-  EFI_STATUS                         Status;
   UINTN                              Width, Heigth;
+  UINTN                              Line;
+  UINT8                              *Dst;
+
+  Width = Area->x2 - Area->x1 + 1;
+  Heigth = Area->y2 - Area->y1 + 1;
+
+  switch (Output->backend) {
+    case LV_UEFI_DISP_BACKEND_LFB_DIRECT:
+      //
+      // LVGL already rendered into the framebuffer.
+      //
+      uefi_disp_fb_sync(Output, Area);
+      break;
+
+    case LV_UEFI_DISP_BACKEND_LFB_FLIP:
+      Dst = Output->frame_buffer + Area->y1 * Output->fb_stride + Area->x1 * Output->fb_format.bytes_per_pixel;
+      for (Line = 0; Line < Heigth; Line++) {
+        Output->convert (Dst, (CONST UINT32 *)Src, Width, &Output->fb_format);
+        Dst += Output->fb_stride;
+        Src += SrcStride;
+      }
+      uefi_disp_fb_sync(Output, Area);
+      break;
+
+    default:
+      //
+      // Blt buffers are EFI_GRAPHICS_OUTPUT_BLT_PIXEL whatever the mode's
+      // pixel format is, the GOP driver converts them itself.
+      //
+      Output->EfiGop->Blt (
+                        Output->EfiGop,
+                        (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)Src,
+                        EfiBltBufferToVideo,
+                        0,
+                        0,
+                        (UINTN)Area->x1,
+                        (UINTN)Area->y1,
+                        Width,
+                        Heigth,
+                        SrcStride
+                        );
+      break;
+  }
+}
+
+
+/**
+  Scale a rendered area to the resolution of one output and put it on the
+  screen. The area is in rotated LVGL coordinates, scr_hor_res x scr_ver_res.
+
+  Native pixel X shows column x_map[X] = X * scr_hor_res / native_hor_res,
+  so an area [x1, x2] covers the native columns from
+  ceil(x1 * native / hor_res) to ceil((x2 + 1) * native / hor_res) - 1.
+  The same holds for lines. The area is scaled in strips of
+  UEFI_DISP_SCALE_LINES lines, repeated lines are copied rather than
+  scaled again. Outputs smaller than the LVGL resolution skip pixels.
+**/
+static void uefi_disp_output_scaled(uefi_disp_data_t * uefi_disp_data, uefi_disp_output_t * Output,
+                                    const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  lv_area_t                          Native, Strip;
+  UINTN                              Width;
+  UINT32                             *Dst;
+  UINT32                             SrcY;
+  INT32                              Y, Row, Lines;
+  BOOLEAN                            Exact2x;
+
+  Native.x1 = (INT32)DivU64x32 ((UINT64)area->x1 * Output->hor_res + uefi_disp_data->scr_hor_res - 1, uefi_disp_data->scr_hor_res);
+  Native.x2 = (INT32)DivU64x32 ((UINT64)(area->x2 + 1) * Output->hor_res + uefi_disp_data->scr_hor_res - 1, uefi_disp_data->scr_hor_res) - 1;
+  Native.y1 = (INT32)DivU64x32 ((UINT64)area->y1 * Output->ver_res + uefi_disp_data->scr_ver_res - 1, uefi_disp_data->scr_ver_res);
+  Native.y2 = (INT32)DivU64x32 ((UINT64)(area->y2 + 1) * Output->ver_res + uefi_disp_data->scr_ver_res - 1, uefi_disp_data->scr_ver_res) - 1;
+  if (Native.x1 > Native.x2 || Native.y1 > Native.y2) {
+    return;
+  }
+
+  Width = Native.x2 - Native.x1 + 1;
+  Exact2x = Output->hor_res == 2 * (UINT32)uefi_disp_data->scr_hor_res;
+
+  for (Y = Native.y1; Y <= Native.y2; Y += Lines) {
+    Lines = LV_MIN(UEFI_DISP_SCALE_LINES, Native.y2 - Y + 1);
+    Dst = Output->staging;
+
+    for (Row = 0; Row < Lines; Row++, Dst += Width) {
+      SrcY = Output->y_map[Y + Row];
+      if (Row > 0 && Output->y_map[Y + Row - 1] == SrcY) {
+        CopyMem (Dst, Dst - Width, Width * sizeof(UINT32));
+      } else if (Exact2x) {
+        lv_uefi_pixel_scale_row_2x(Dst, (CONST UINT32 *)(Src + (SrcY - area->y1) * SrcStride), Width / 2);
+      } else {
+        lv_uefi_pixel_scale_row(Dst, (CONST UINT32 *)(Src + (SrcY - area->y1) * SrcStride) - area->x1,
+                                Output->x_map + Native.x1, Width);
+      }
+    }
+
+    Strip.x1 = Native.x1;
+    Strip.x2 = Native.x2;
+    Strip.y1 = Y;
+    Strip.y2 = Y + Lines - 1;
+    uefi_disp_output_area(Output, &Strip, (CONST UINT8 *)Output->staging, Width * sizeof(UINT32));
+  }
+}
+
+
+/**
+  Put a rendered area, given in rotated LVGL coordinates, on every output.
+  The area was rendered and rotated once, only scaling is per output.
+**/
+static void uefi_disp_output_screen(uefi_disp_data_t * uefi_disp_data, const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  uefi_disp_output_t                 *Output;
+  UINT32                             Index;
+
+  for (Index = 0; Index < uefi_disp_data->output_cnt; Index++) {
+    Output = &uefi_disp_data->outputs[Index];
+    if (Output->x_map != NULL) {
+      uefi_disp_output_scaled(uefi_disp_data, Output, area, Src, SrcStride);
+    } else {
+      uefi_disp_output_area(Output, area, Src, SrcStride);
+    }
+  }
+}
+
+
+/**
+  Rotate a rendered area clockwise and put it on the screen.
+
+  Only the area is rotated, in strips of UEFI_DISP_ROTATE_LINES screen
+  lines. For 90 and 270 degrees a strip is a run of LVGL columns, for 180
+  degrees a run of LVGL lines. With a LVGL resolution of W x H:
+
+     90: (x, y) -> (H - 1 - y, x)
+    180: (x, y) -> (W - 1 - x, H - 1 - y)
+    270: (x, y) -> (y, W - 1 - x)
+**/
+static void uefi_disp_output_rotated(uefi_disp_data_t * uefi_disp_data, const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  lv_area_t                          Strip;
+  INT32                              W, H;
+  INT32                              Pos, Count;
+
+  W = uefi_disp_data->hor_res;
+  H = uefi_disp_data->ver_res;
+
+  if (uefi_disp_data->rotation == LV_DISPLAY_ROTATION_180) {
+    for (Pos = area->y1; Pos <= area->y2; Pos += Count) {
+      Count = LV_MIN(UEFI_DISP_ROTATE_LINES, area->y2 - Pos + 1);
+      lv_uefi_pixel_rotate(uefi_disp_data->rotated, lv_area_get_width(area),
+                           (CONST UINT32 *)(Src + (Pos - area->y1) * SrcStride), SrcStride / sizeof(UINT32),
+                           lv_area_get_width(area), Count, LV_DISPLAY_ROTATION_180);
+      Strip.x1 = W - 1 - area->x2;
+      Strip.x2 = W - 1 - area->x1;
+      Strip.y1 = H - Pos - Count;
+      Strip.y2 = H - 1 - Pos;
+      uefi_disp_output_screen(uefi_disp_data, &Strip, (CONST UINT8 *)uefi_disp_data->rotated,
+                              lv_area_get_width(area) * sizeof(UINT32));
+    }
+    return;
+  }
+
+  for (Pos = area->x1; Pos <= area->x2; Pos += Count) {
+    Count = LV_MIN(UEFI_DISP_ROTATE_LINES, area->x2 - Pos + 1);
+    lv_uefi_pixel_rotate(uefi_disp_data->rotated, lv_area_get_height(area),
+                         (CONST UINT32 *)(Src + (Pos - area->x1) * sizeof(UINT32)), SrcStride / sizeof(UINT32),
+                         Count, lv_area_get_height(area), uefi_disp_data->rotation);
+    if (uefi_disp_data->rotation == LV_DISPLAY_ROTATION_90) {
+      Strip.x1 = H - 1 - area->y2;
+      Strip.x2 = H - 1 - area->y1;
+      Strip.y1 = Pos;
+      Strip.y2 = Pos + Count - 1;
+    } else {
+      Strip.x1 = area->y1;
+      Strip.x2 = area->y2;
+      Strip.y1 = W - Pos - Count;
+      Strip.y2 = W - 1 - Pos;
+    }
+    uefi_disp_output_screen(uefi_disp_data, &Strip, (CONST UINT8 *)uefi_disp_data->rotated,
+                            lv_area_get_height(area) * sizeof(UINT32));
+  }
+}
+
+
+/**
+  Put pixels, given in LVGL coordinates, on the screen.
+**/
+static void uefi_disp_output_logical(uefi_disp_data_t * uefi_disp_data, const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  if (uefi_disp_data->rotation != LV_DISPLAY_ROTATION_0) {
+    uefi_disp_output_rotated(uefi_disp_data, area, Src, SrcStride);
+  } else {
+    uefi_disp_output_screen(uefi_disp_data, area, Src, SrcStride);
+  }
+}
+
+
+/**
+  Blend one ARGB8888 cursor pixel over a rendered XRGB8888 pixel.
+**/
+static UINT32 uefi_disp_cursor_blend(UINT32 Dst, UINT32 Src)
+{
+  UINT32                             A;
+  UINT32                             RB, G;
+
+  A = Src >> 24;
+  if (A == 0) {
+    return Dst;
+  }
+  if (A == 0xFF) {
+    return Src;
+  }
+
+  RB = (((Src & 0xFF00FF) * A + (Dst & 0xFF00FF) * (0xFF - A)) >> 8) & 0xFF00FF;
+  G  = (((Src & 0x00FF00) * A + (Dst & 0x00FF00) * (0xFF - A)) >> 8) & 0x00FF00;
+  return 0xFF000000 | RB | G;
+}
+
+
+/**
+  Offset of a pixel of the cursor area in the icon sized buffers.
+**/
+static UINTN uefi_disp_cursor_offset(const uefi_disp_cursor_t * Cursor, int32_t X, int32_t Y)
+{
+  return (UINTN)(Y - Cursor->pos.y) * Cursor->icon->header.w + (X - Cursor->pos.x);
+}
+
+
+/**
+  Copy rendered pixels below the cursor into the save-under buffer and
+  blend the icon over them into the composed buffer.
+
+  @param  Area        Part of the cursor area to update.
+  @param  Src         First pixel of Area in the rendered frame.
+  @param  SrcStride   Source line length in bytes.
+**/
+static void uefi_disp_cursor_compose(uefi_disp_cursor_t * Cursor, const lv_area_t * Area, const UINT8 * Src, UINTN SrcStride)
+{
+  const UINT32                       *Icon;
+  UINT32                             *Under, *Out;
+  UINTN                              IconStride, Width, X;
+  INT32                              Y;
+
+  IconStride = Cursor->icon->header.stride != 0 ? Cursor->icon->header.stride : Cursor->icon->header.w * sizeof(UINT32);
+  Width = lv_area_get_width(Area);
+
+  for (Y = Area->y1; Y <= Area->y2; Y++, Src += SrcStride) {
+    Under = Cursor->save_under + uefi_disp_cursor_offset(Cursor, Area->x1, Y);
+    Out = Cursor->composed + uefi_disp_cursor_offset(Cursor, Area->x1, Y);
+    Icon = (CONST UINT32 *)(Cursor->icon->data + (Y - Cursor->pos.y) * IconStride) + (Area->x1 - Cursor->pos.x);
+
+    CopyMem (Under, Src, Width * sizeof(UINT32));
+    for (X = 0; X < Width; X++) {
+      Out[X] = uefi_disp_cursor_blend(Under[X], Icon[X]);
+    }
+  }
+}
+
+
+/**
+  Draw the whole cursor from the last complete frame.
+**/
+static void uefi_disp_cursor_draw(uefi_disp_data_t * uefi_disp_data)
+{
+  uefi_disp_cursor_t                 *Cursor = &uefi_disp_data->cursor;
+  lv_area_t                          *Area = &Cursor->area;
+
+  if (!Cursor->visible || Cursor->frame == NULL) {
+    return;
+  }
+
+  uefi_disp_cursor_compose(Cursor, Area,
+                           Cursor->frame + Area->y1 * Cursor->frame_stride + Area->x1 * sizeof(UINT32),
+                           Cursor->frame_stride);
+  uefi_disp_output_logical(uefi_disp_data, Area,
+                           (CONST UINT8 *)(Cursor->composed + uefi_disp_cursor_offset(Cursor, Area->x1, Area->y1)),
+                           Cursor->icon->header.w * sizeof(UINT32));
+  Cursor->drawn = TRUE;
+}
+
+
+/**
+  Put a rendered area, given in LVGL coordinates, on the screen.
+
+  The part below the cursor overlay refreshes the save-under buffer and
+  goes out with the icon blended on top, the rest of the area as rendered,
+  so the cursor never disappears while widgets below it change.
+**/
+static void uefi_disp_present_area(uefi_disp_data_t * uefi_disp_data, const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  uefi_disp_cursor_t                 *Cursor = &uefi_disp_data->cursor;
+  lv_area_t                          Under, Piece;
+  const UINT8                        *Row;
+
+  if (Cursor->icon == NULL || !Cursor->visible || !lv_area_intersect(&Under, area, &Cursor->area)) {
+    uefi_disp_output_logical(uefi_disp_data, area, Src, SrcStride);
+    return;
+  }
+
+  Row = Src + (Under.y1 - area->y1) * SrcStride;
+  uefi_disp_cursor_compose(Cursor, &Under, Row + (Under.x1 - area->x1) * sizeof(UINT32), SrcStride);
+
+  Piece = *area;
+  if (Under.y1 > area->y1) {
+    Piece.y2 = Under.y1 - 1;
+    uefi_disp_output_logical(uefi_disp_data, &Piece, Src, SrcStride);
+  }
+  if (Under.y2 < area->y2) {
+    Piece.y1 = Under.y2 + 1;
+    Piece.y2 = area->y2;
+    uefi_disp_output_logical(uefi_disp_data, &Piece, Src + (Piece.y1 - area->y1) * SrcStride, SrcStride);
+  }
+
+  Piece.y1 = Under.y1;
+  Piece.y2 = Under.y2;
+  if (Under.x1 > area->x1) {
+    Piece.x1 = area->x1;
+    Piece.x2 = Under.x1 - 1;
+    uefi_disp_output_logical(uefi_disp_data, &Piece, Row, SrcStride);
+  }
+  if (Under.x2 < area->x2) {
+    Piece.x1 = Under.x2 + 1;
+    Piece.x2 = area->x2;
+    uefi_disp_output_logical(uefi_disp_data, &Piece, Row + (Piece.x1 - area->x1) * sizeof(UINT32), SrcStride);
+  }
+
+  uefi_disp_output_logical(uefi_disp_data, &Under,
+                           (CONST UINT8 *)(Cursor->composed + uefi_disp_cursor_offset(Cursor, Under.x1, Under.y1)),
+                           Cursor->icon->header.w * sizeof(UINT32));
+}
+
+
+/**
+  Compare one tile with the shadow frame and bring the shadow up to date.
+
+  @retval TRUE    The tile differs from what is on the screen.
+**/
+static BOOLEAN uefi_disp_tile_update(uefi_disp_data_t * uefi_disp_data, const lv_area_t * Tile, const UINT8 * Src, UINTN SrcStride)
+{
+  UINT32                             *Shadow;
+  UINTN                              Width;
+  INT32                              Y;
+  BOOLEAN                            Changed;
+
+  Width = Tile->x2 - Tile->x1 + 1;
+  Shadow = uefi_disp_data->shadow + Tile->y1 * uefi_disp_data->hor_res + Tile->x1;
+  Changed = FALSE;
+
+  for (Y = Tile->y1; Y <= Tile->y2; Y++) {
+    if (Changed || !lv_uefi_pixel_row_equal((CONST UINT32 *)Src, Shadow, Width)) {
+      CopyMem (Shadow, Src, Width * sizeof(UINT32));
+      Changed = TRUE;
+    }
+    Src += SrcStride;
+    Shadow += uefi_disp_data->hor_res;
+  }
+
+  return Changed;
+}
+
+
+/**
+  Put a rendered area on the screen, skipping the tiles of the
+  UEFI_DISP_TILE_SIZE grid whose pixels did not change since they were
+  last presented. Changed neighbours within a tile row go out together.
+**/
+static void uefi_disp_present(uefi_disp_data_t * uefi_disp_data, const lv_area_t * area, const UINT8 * Src, UINTN SrcStride)
+{
+  uefi_disp_stats_t                  *stats = &uefi_disp_data->stats;
+  lv_area_t                          Tile, Run;
+  INT32                              TileX, TileY;
+  BOOLEAN                            RunOpen;
+
+  if (uefi_disp_data->shadow == NULL) {
+    uefi_disp_present_area(uefi_disp_data, area, Src, SrcStride);
+    return;
+  }
+
+  for (TileY = area->y1 - area->y1 % UEFI_DISP_TILE_SIZE; TileY <= area->y2; TileY += UEFI_DISP_TILE_SIZE) {
+    Tile.y1 = LV_MAX(TileY, area->y1);
+    Tile.y2 = LV_MIN(TileY + UEFI_DISP_TILE_SIZE - 1, area->y2);
+    RunOpen = FALSE;
+
+    for (TileX = area->x1 - area->x1 % UEFI_DISP_TILE_SIZE; TileX <= area->x2; TileX += UEFI_DISP_TILE_SIZE) {
+      Tile.x1 = LV_MAX(TileX, area->x1);
+      Tile.x2 = LV_MIN(TileX + UEFI_DISP_TILE_SIZE - 1, area->x2);
+      stats->tiles_checked++;
+
+      if (uefi_disp_tile_update(uefi_disp_data, &Tile,
+                                Src + (Tile.y1 - area->y1) * SrcStride + (Tile.x1 - area->x1) * sizeof(UINT32),
+                                SrcStride)) {
+        if (!RunOpen) {
+          Run = Tile;
+          RunOpen = TRUE;
+        }
+        Run.x2 = Tile.x2;
+        continue;
+      }
+
+      stats->tiles_skipped++;
+      stats->tile_bytes_skipped += lv_area_get_size(&Tile) * sizeof(UINT32);
+      if (RunOpen) {
+        uefi_disp_present_area(uefi_disp_data, &Run,
+                               Src + (Run.y1 - area->y1) * SrcStride + (Run.x1 - area->x1) * sizeof(UINT32), SrcStride);
+        RunOpen = FALSE;
+      }
+    }
+
+    if (RunOpen) {
+      uefi_disp_present_area(uefi_disp_data, &Run,
+                             Src + (Run.y1 - area->y1) * SrcStride + (Run.x1 - area->x1) * sizeof(UINT32), SrcStride);
+    }
+  }
+}
+
+
+/**
+  Merge the pending dirty areas of a direct mode refresh in place.
+
+  Two areas are replaced by their bounding box when that box adds no more
+  than merge_slack pixels which neither of them covers. Overlapping areas
+  therefore usually merge, and so do small neighbours such as the pieces
+  of a focus ring, which are cheaper as one Blt than as several.
+
+  @return Number of bytes the merged set copies less than the input set.
+**/
+static INT64 uefi_disp_coalesce(uefi_disp_data_t * uefi_disp_data)
+{
+  lv_area_t                          *Areas = uefi_disp_data->pending;
+  lv_area_t                          Union, Overlap;
+  INT64                              BytesIn, BytesOut;
+  INT64                              Covered;
+  UINT32                             Index, Other;
+  BOOLEAN                            Merged;
+
+  BytesIn = 0;
+  for (Index = 0; Index < uefi_disp_data->pending_cnt; Index++) {
+    BytesIn += lv_area_get_size(&Areas[Index]);
+  }
+
+  do {
+    Merged = FALSE;
+    for (Index = 0; Index < uefi_disp_data->pending_cnt; Index++) {
+      for (Other = Index + 1; Other < uefi_disp_data->pending_cnt; Other++) {
+        lv_area_join(&Union, &Areas[Index], &Areas[Other]);
+        Covered = (INT64)lv_area_get_size(&Areas[Index]) + lv_area_get_size(&Areas[Other]);
+        if (lv_area_intersect(&Overlap, &Areas[Index], &Areas[Other])) {
+          Covered -= lv_area_get_size(&Overlap);
+        }
+
+        if ((INT64)lv_area_get_size(&Union) - Covered > (INT64)uefi_disp_data->merge_slack) {
+          continue;
+        }
+
+        Areas[Index] = Union;
+        Areas[Other] = Areas[--uefi_disp_data->pending_cnt];
+        Merged = TRUE;
+        Other = Index;
+      }
+    }
+  } while (Merged);
+
+  BytesOut = 0;
+  for (Index = 0; Index < uefi_disp_data->pending_cnt; Index++) {
+    BytesOut += lv_area_get_size(&Areas[Index]);
+  }
+
+  return (BytesIn - BytesOut) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+}
+
+
+/**
+  Submit the coalesced dirty areas of a direct mode refresh.
+
+  @param  Complete    The refresh has been rendered completely. Areas of a
+                      refresh still being rendered go out when too many are
+                      pending, but the buffer does not hold a whole frame
+                      the cursor could be redrawn from yet.
+**/
+static void uefi_disp_flush_pending(uefi_disp_data_t * uefi_disp_data, UINT8 * Buffer, UINTN Stride, BOOLEAN Complete)
+{
+  uefi_disp_stats_t                  *stats = &uefi_disp_data->stats;
+  lv_area_t                          *Area;
+  UINT32                             AreaCnt;
+  INT64                              BytesSaved;
+  UINT32                             Index;
+
+  AreaCnt = uefi_disp_data->pending_cnt;
+  BytesSaved = uefi_disp_coalesce(uefi_disp_data);
+
+  for (Index = 0; Index < uefi_disp_data->pending_cnt; Index++) {
+    Area = &uefi_disp_data->pending[Index];
+    uefi_disp_present(uefi_disp_data, Area,
+                      Buffer + Area->y1 * Stride + Area->x1 * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), Stride);
+  }
+
+  if (AreaCnt != uefi_disp_data->pending_cnt) {
+    DebugPrint (DEBUG_VERBOSE, "LVGL display: %d areas -> %d Blt, %ld bytes saved\n",
+                AreaCnt, uefi_disp_data->pending_cnt, BytesSaved);
+  }
+
+  stats->blt_calls += uefi_disp_data->pending_cnt;
+  stats->blt_calls_saved += AreaCnt - uefi_disp_data->pending_cnt;
+  stats->bytes_saved += BytesSaved;
+  uefi_disp_data->pending_cnt = 0;
+
+  if (!Complete) {
+    return;
+  }
+
+  //
+  // The buffer now holds the complete frame, and LVGL only reads it until
+  // the refresh after next.
+  //
+  if (uefi_disp_data->cursor.icon != NULL && uefi_disp_data->shadow == NULL) {
+    uefi_disp_data->cursor.frame = Buffer;
+    uefi_disp_data->cursor.frame_stride = Stride;
+  }
+  if (uefi_disp_data->cursor.icon != NULL && !uefi_disp_data->cursor.drawn) {
+    uefi_disp_cursor_draw(uefi_disp_data);
+  }
+}
+
+
+void uefi_disp_flush(lv_display_t * disp, const lv_area_t * area, lv_color32_t * color32_p)
+{
   uefi_disp_data_t                   *uefi_disp_data;
-  UINTN                              Delta;
+  UINT8                              *Src;
+  UINTN                              SrcStride;
 
   uefi_disp_data = lv_display_get_driver_data(disp);
+  uefi_disp_data->stats.flush_calls++;
+
+  //
+  // In partial mode the buffer only holds the flushed area and is reused
+  // for the next band, so it has to go out right away.
+  //
+  if (uefi_disp_data->render_mode == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+    SrcStride = (area->x2 - area->x1 + 1) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    uefi_disp_present(uefi_disp_data, area, (UINT8 *)color32_p, SrcStride);
+    uefi_disp_data->stats.blt_calls++;
+    if (lv_display_flush_is_last(disp)) {
+      if (uefi_disp_data->cursor.icon != NULL && !uefi_disp_data->cursor.drawn) {
+        uefi_disp_cursor_draw(uefi_disp_data);
+      }
+      UefiLvglLatencyShown ();
+    }
+    lv_display_flush_ready(disp);
+    return;
+  }
+
+  if (uefi_disp_data->outputs[0].backend == LV_UEFI_DISP_BACKEND_LFB_DIRECT) {
+    uefi_disp_output_area(&uefi_disp_data->outputs[0], area, NULL, 0);
+    if (lv_display_flush_is_last(disp)) {
+      UefiLvglLatencyShown ();
+    }
+    lv_display_flush_ready(disp);
+    return;
+  }
 
-  Width = area->x2 - area->x1 + 1;
-  Heigth = area->y2 - area->y1 + 1;
-  Delta = uefi_disp_data->EfiGop->Mode->Info->HorizontalResolution * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
-
-  Status = uefi_disp_data->EfiGop->Blt (
-                                     uefi_disp_data->EfiGop,
-                                     (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)color32_p,
-                                     EfiBltBufferToVideo,
-                                     (UINTN)area->x1,
-                                     (UINTN)area->y1,
-                                     (UINTN)area->x1,
-                                     (UINTN)area->y1,
-                                     Width,
-                                     Heigth,
-                                     Delta
-                                     );
+  //
+  // In direct mode every area of the refresh lives in the same full screen
+  // buffer, which LVGL does not touch again before the next refresh. Collect
+  // the areas and submit them once the last one has been rendered.
+  //
+  Src = (UINT8 *)color32_p;
+  SrcStride = lv_display_get_horizontal_resolution(disp) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
+  if (uefi_disp_data->pending_cnt == UEFI_DISP_MAX_PENDING) {
+    uefi_disp_flush_pending(uefi_disp_data, Src, SrcStride, FALSE);
+  }
+  uefi_disp_data->pending[uefi_disp_data->pending_cnt++] = *area;
+
+  if (lv_display_flush_is_last(disp)) {
+    uefi_disp_flush_pending(uefi_disp_data, Src, SrcStride, TRUE);
+    UefiLvglLatencyShown ();
+  }
 
   lv_display_flush_ready(disp);
 }
 
 
-lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res)
+/**
+  Map the framebuffer write-combining, and find out whether the port has
+  to clean the lines it writes.
+
+  Write-combining is only requested when the platform allows it through
+  PcdLvglFrameBufferWriteCombine and the GCD descriptor lists EFI_MEMORY_WC
+  in its capabilities. If the range stays cacheable and the platform says
+  scanout is not coherent (PcdLvglFrameBufferNonCoherent), flushed lines
+  are cleaned to memory.
+**/
+static void uefi_disp_map_framebuffer(uefi_disp_output_t * Output)
+{
+    EFI_STATUS                       Status;
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR  Desc;
+    EFI_PHYSICAL_ADDRESS             Base;
+    UINT64                           Length;
+    UINT64                           CacheMask;
+
+    CacheMask = EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | EFI_MEMORY_UCE;
+    Base = Output->EfiGop->Mode->FrameBufferBase & ~(UINT64)EFI_PAGE_MASK;
+    Length = ALIGN_VALUE (Output->EfiGop->Mode->FrameBufferBase + Output->EfiGop->Mode->FrameBufferSize - Base, EFI_PAGE_SIZE);
+
+    Status = gDS->GetMemorySpaceDescriptor (Base, &Desc);
+    if (EFI_ERROR (Status)) {
+        DebugPrint (DEBUG_WARN, "LVGL display: no GCD descriptor for the framebuffer - %r\n", Status);
+        return;
+    }
+
+    if (FixedPcdGetBool (PcdLvglFrameBufferWriteCombine) &&
+        (Desc.Capabilities & EFI_MEMORY_WC) != 0 && (Desc.Attributes & EFI_MEMORY_WC) == 0) {
+        Status = gDS->SetMemorySpaceAttributes (Base, Length, (Desc.Attributes & ~CacheMask) | EFI_MEMORY_WC);
+        if (!EFI_ERROR (Status)) {
+            Desc.Attributes = (Desc.Attributes & ~CacheMask) | EFI_MEMORY_WC;
+        }
+        DebugPrint (DEBUG_INFO, "LVGL display: framebuffer write-combining - %r\n", Status);
+    }
+
+    Output->fb_clean = FixedPcdGetBool (PcdLvglFrameBufferNonCoherent) &&
+                       (Desc.Attributes & (EFI_MEMORY_WB | EFI_MEMORY_WT)) != 0 &&
+                       (Desc.Attributes & (EFI_MEMORY_WC | EFI_MEMORY_UC)) == 0;
+}
+
+
+/**
+  Check whether the GOP mode has a linear framebuffer the port can write,
+  and fall back to Blt otherwise. LVGL can only render into a framebuffer
+  laid out like lv_color32_t at the GOP resolution; other formats, and a
+  reduced render resolution, go through the flip back buffer.
+**/
+static lv_uefi_disp_backend_t uefi_disp_select_backend(uefi_disp_output_t * Output, lv_uefi_disp_backend_t backend,
+                                                       int32_t hor_res, int32_t ver_res)
+{
+    EFI_GRAPHICS_OUTPUT_PROTOCOL          *Gop = Output->EfiGop;
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  *Info = Gop->Mode->Info;
+
+    if (backend == LV_UEFI_DISP_BACKEND_BLT) {
+        return LV_UEFI_DISP_BACKEND_BLT;
+    }
+
+    if (Gop->Mode->FrameBufferBase == 0 ||
+        EFI_ERROR (lv_uefi_pixel_format_init(&Output->fb_format, Info)) ||
+        Gop->Mode->FrameBufferSize < (UINTN)Info->PixelsPerScanLine * Info->VerticalResolution * Output->fb_format.bytes_per_pixel) {
+        DebugPrint (DEBUG_INFO, "LVGL display: linear framebuffer unusable (format %d), using Blt\n", Info->PixelFormat);
+        return LV_UEFI_DISP_BACKEND_BLT;
+    }
+
+    if (backend == LV_UEFI_DISP_BACKEND_LFB_DIRECT &&
+        (Output->fb_format.kind != LV_UEFI_PIXEL_BGRX8888 ||
+         Info->HorizontalResolution != (UINT32)hor_res || Info->VerticalResolution != (UINT32)ver_res)) {
+        DebugPrint (DEBUG_INFO, "LVGL display: framebuffer format %d at %dx%d needs conversion, using a back buffer\n",
+                    Info->PixelFormat, hor_res, ver_res);
+        backend = LV_UEFI_DISP_BACKEND_LFB_FLIP;
+    }
+
+    Output->frame_buffer = (UINT8 *)(UINTN)Gop->Mode->FrameBufferBase;
+    Output->fb_stride = Info->PixelsPerScanLine * Output->fb_format.bytes_per_pixel;
+    Output->convert = lv_uefi_pixel_select(&Output->fb_format);
+    uefi_disp_map_framebuffer(Output);
+
+    return backend;
+}
+
+
+/**
+  Get the GOP resolution of the primary output, which differs from the
+  LVGL resolution when rendering at a reduced internal resolution.
+**/
+void lv_uefi_disp_get_native_resolution(lv_display_t * disp, int32_t * hor_res, int32_t * ver_res)
+{
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+
+    *hor_res = (int32_t)uefi_disp_data->outputs[0].hor_res;
+    *ver_res = (int32_t)uefi_disp_data->outputs[0].ver_res;
+}
+
+
+/**
+  Map a point in GOP coordinates of the primary output, e.g. from a pointer
+  device, to the LVGL pixel shown there.
+**/
+void lv_uefi_disp_native_to_logical(lv_display_t * disp, lv_point_t * point)
+{
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    uefi_disp_output_t * Output = &uefi_disp_data->outputs[0];
+    int32_t x, y;
+
+    point->x = LV_CLAMP(0, point->x, (int32_t)Output->hor_res - 1);
+    point->y = LV_CLAMP(0, point->y, (int32_t)Output->ver_res - 1);
+
+    if (Output->x_map != NULL) {
+        point->x = (int32_t)Output->x_map[point->x];
+        point->y = (int32_t)Output->y_map[point->y];
+    }
+
+    /*Undo the flush rotation, see uefi_disp_output_rotated()*/
+    x = point->x;
+    y = point->y;
+    switch (uefi_disp_data->rotation) {
+        case LV_DISPLAY_ROTATION_90:
+            point->x = y;
+            point->y = uefi_disp_data->ver_res - 1 - x;
+            break;
+        case LV_DISPLAY_ROTATION_180:
+            point->x = uefi_disp_data->hor_res - 1 - x;
+            point->y = uefi_disp_data->ver_res - 1 - y;
+            break;
+        case LV_DISPLAY_ROTATION_270:
+            point->x = uefi_disp_data->hor_res - 1 - y;
+            point->y = x;
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+  Turn a relative movement as the user sees it, e.g. from a mouse, into
+  GOP directions, so that a pointer tracked in GOP coordinates moves the
+  same way on a rotated panel.
+**/
+void lv_uefi_disp_rotate_motion(lv_display_t * disp, lv_point_t * delta)
+{
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    int32_t dx = delta->x;
+    int32_t dy = delta->y;
+
+    switch (uefi_disp_data->rotation) {
+        case LV_DISPLAY_ROTATION_90:
+            delta->x = -dy;
+            delta->y = dx;
+            break;
+        case LV_DISPLAY_ROTATION_180:
+            delta->x = -dx;
+            delta->y = -dy;
+            break;
+        case LV_DISPLAY_ROTATION_270:
+            delta->x = dy;
+            delta->y = -dx;
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+  Composite the pointer cursor at flush time instead of rendering it as an
+  LVGL object.
+
+  A move then restores the pixels saved below the old position and blends
+  the icon at the new one, two small outputs and no LVGL redraw. The
+  pixels below the new position come from the last complete frame: the
+  tile diff shadow, or the direct mode render buffer. Without either, or
+  when LVGL renders straight into the framebuffer, there is nothing to
+  composite from and the caller has to draw the cursor with LVGL.
+
+  @param  icon    ARGB8888 image, its top left corner is the hot spot.
+
+  @retval true    The display draws the cursor, see lv_uefi_disp_move_cursor().
+**/
+bool lv_uefi_disp_set_cursor(lv_display_t * disp, const lv_image_dsc_t * icon)
+{
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    uefi_disp_cursor_t * Cursor = &uefi_disp_data->cursor;
+    UINTN Size;
+
+    if (icon == NULL || icon->header.cf != LV_COLOR_FORMAT_ARGB8888 ||
+        uefi_disp_data->outputs[0].backend == LV_UEFI_DISP_BACKEND_LFB_DIRECT ||
+        (uefi_disp_data->render_mode == LV_DISPLAY_RENDER_MODE_PARTIAL && uefi_disp_data->shadow == NULL)) {
+        return false;
+    }
+
+    Size = icon->header.w * icon->header.h * sizeof(UINT32);
+    Cursor->save_under = uefi_disp_malloc (Size);
+    Cursor->composed = uefi_disp_malloc (Size);
+    if (Cursor->save_under == NULL || Cursor->composed == NULL) {
+        uefi_disp_free(Cursor->save_under);
+        uefi_disp_free(Cursor->composed);
+        Cursor->save_under = NULL;
+        Cursor->composed = NULL;
+        return false;
+    }
+
+    if (uefi_disp_data->shadow != NULL) {
+        Cursor->frame = (CONST UINT8 *)uefi_disp_data->shadow;
+        Cursor->frame_stride = uefi_disp_data->hor_res * sizeof(UINT32);
+    }
+    Cursor->icon = icon;
+    Cursor->visible = FALSE;
+    Cursor->drawn = FALSE;
+
+    return true;
+}
+
+
+/**
+  Move the cursor overlay to a point in LVGL coordinates and put the
+  change on the screen right away.
+**/
+void lv_uefi_disp_move_cursor(lv_display_t * disp, const lv_point_t * pos)
+{
+    uefi_disp_data_t * uefi_disp_data = lv_display_get_driver_data(disp);
+    uefi_disp_cursor_t * Cursor = &uefi_disp_data->cursor;
+    lv_area_t Screen, Icon;
+
+    if (Cursor->icon == NULL) {
+        return;
+    }
+    if (Cursor->drawn && Cursor->pos.x == pos->x && Cursor->pos.y == pos->y) {
+        return;
+    }
+
+    if (Cursor->drawn) {
+        uefi_disp_output_logical(uefi_disp_data, &Cursor->area,
+                                 (CONST UINT8 *)(Cursor->save_under + uefi_disp_cursor_offset(Cursor, Cursor->area.x1, Cursor->area.y1)),
+                                 Cursor->icon->header.w * sizeof(UINT32));
+        Cursor->drawn = FALSE;
+        uefi_disp_data->stats.cursor_moves++;
+    }
+
+    Cursor->pos = *pos;
+    lv_area_set(&Screen, 0, 0, uefi_disp_data->hor_res - 1, uefi_disp_data->ver_res - 1);
+    lv_area_set(&Icon, pos->x, pos->y, pos->x + Cursor->icon->header.w - 1, pos->y + Cursor->icon->header.h - 1);
+    Cursor->visible = lv_area_intersect(&Cursor->area, &Icon, &Screen);
+
+    uefi_disp_cursor_draw(uefi_disp_data);
+    if (Cursor->drawn) {
+        UefiLvglLatencyShown ();
+    }
+}
+
+
+/**
+  Set up the native -> LVGL coordinate maps and the staging strip used
+  when an output's resolution differs from the (rotated) LVGL resolution.
+**/
+static EFI_STATUS uefi_disp_create_scaler(uefi_disp_data_t * uefi_disp_data, uefi_disp_output_t * Output)
+{
+    UINT32               Index;
+
+    if ((UINT32)uefi_disp_data->scr_hor_res == Output->hor_res && (UINT32)uefi_disp_data->scr_ver_res == Output->ver_res) {
+        return EFI_SUCCESS;
+    }
+
+    Output->x_map = uefi_disp_malloc (Output->hor_res * sizeof(UINT32));
+    Output->y_map = uefi_disp_malloc (Output->ver_res * sizeof(UINT32));
+    Output->staging = uefi_disp_malloc (Output->hor_res * UEFI_DISP_SCALE_LINES * sizeof(UINT32));
+    if (Output->x_map == NULL || Output->y_map == NULL || Output->staging == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    for (Index = 0; Index < Output->hor_res; Index++) {
+        Output->x_map[Index] = (UINT32)DivU64x32 ((UINT64)Index * uefi_disp_data->scr_hor_res, Output->hor_res);
+    }
+    for (Index = 0; Index < Output->ver_res; Index++) {
+        Output->y_map[Index] = (UINT32)DivU64x32 ((UINT64)Index * uefi_disp_data->scr_ver_res, Output->ver_res);
+    }
+
+    DebugPrint (DEBUG_INFO, "LVGL display: rendering at %dx%d, scaled to %dx%d\n",
+                uefi_disp_data->scr_hor_res, uefi_disp_data->scr_ver_res, Output->hor_res, Output->ver_res);
+
+    return EFI_SUCCESS;
+}
+
+
+/**
+  Find the GOP instances to show the display on, the first one being the
+  primary output.
+
+  Only handles with a device path are used: the console splitter installs
+  a virtual GOP without one, which already mirrors to the real outputs.
+  Handles sharing a framebuffer, such as two views of one BMC video device,
+  are kept once so the same pixels are not flushed twice. Without any such
+  handle, the instance LocateProtocol returns is used.
+
+  @param  Gop   Receives up to Max instances.
+  @param  Max   Size of Gop.
+
+  @return Number of instances stored in Gop.
+**/
+UINT32 lv_uefi_disp_locate_outputs(EFI_GRAPHICS_OUTPUT_PROTOCOL ** Gop, UINT32 Max)
 {
     EFI_STATUS                    Status;
-    EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput;
+    EFI_HANDLE                    *HandleBuffer = NULL;
+    UINTN                         HandleCount, Index;
+    EFI_DEVICE_PATH_PROTOCOL      *DevicePath;
+    EFI_GRAPHICS_OUTPUT_PROTOCOL  *Candidate;
+    UINT32                        Count, Other;
+
+    Count = 0;
+    HandleCount = 0;
+    Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiGraphicsOutputProtocolGuid, NULL, &HandleCount, &HandleBuffer);
+    for (Index = 0; Index < HandleCount && Count < Max; Index++) {
+        Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiDevicePathProtocolGuid, (VOID **)&DevicePath);
+        if (EFI_ERROR (Status)) {
+            continue;
+        }
+        Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiGraphicsOutputProtocolGuid, (VOID **)&Candidate);
+        if (EFI_ERROR (Status) || Candidate->Mode == NULL || Candidate->Mode->Info == NULL) {
+            continue;
+        }
+
+        for (Other = 0; Other < Count; Other++) {
+            if (Candidate->Mode->FrameBufferBase != 0 &&
+                Candidate->Mode->FrameBufferBase == Gop[Other]->Mode->FrameBufferBase) {
+                break;
+            }
+        }
+        if (Other < Count) {
+            DebugPrint (DEBUG_INFO, "LVGL display: GOP %d shares the framebuffer of GOP %d, skipped\n",
+                        (UINT32)Index, Other);
+            continue;
+        }
+
+        Gop[Count++] = Candidate;
+    }
+    if (HandleBuffer != NULL) {
+        FreePool (HandleBuffer);
+    }
+
+    if (Count == 0 && Max > 0) {
+        Status = gBS->LocateProtocol (&gEfiGraphicsOutputProtocolGuid, NULL, (VOID **)&Gop[0]);
+        if (!EFI_ERROR (Status)) {
+            Count = 1;
+        }
+    }
+
+    return Count;
+}
+
 
-    Status = gBS->LocateProtocol (&gEfiGraphicsOutputProtocolGuid, NULL, (VOID **) &GraphicsOutput);
-    if (EFI_ERROR(Status)) {
+lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res, const lv_uefi_disp_config_t * config)
+{
+    EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput[UEFI_DISP_MAX_OUTPUTS];
+    UINT32                        OutputCnt;
+    UINT32                        Index;
+    lv_display_render_mode_t      render_mode;
+    uint32_t                      band_lines;
+    uint32_t                      band_count;
+    UINTN                         BufSize;
+    uefi_disp_output_t            *Output;
+    lv_uefi_disp_backend_t        backend;
+
+    OutputCnt = lv_uefi_disp_locate_outputs(GraphicsOutput, UEFI_DISP_MAX_OUTPUTS);
+    if (OutputCnt == 0) {
         return NULL;
     }
 
@@ -63,7 +1142,57 @@ lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res)
     LV_ASSERT_MALLOC(uefi_disp_data);
     if(NULL == uefi_disp_data) return NULL;
 
-    uefi_disp_data->EfiGop = GraphicsOutput;
+    uefi_disp_data->output_cnt = OutputCnt;
+    for (Index = 0; Index < OutputCnt; Index++) {
+        Output = &uefi_disp_data->outputs[Index];
+        Output->EfiGop = GraphicsOutput[Index];
+        Output->hor_res = GraphicsOutput[Index]->Mode->Info->HorizontalResolution;
+        Output->ver_res = GraphicsOutput[Index]->Mode->Info->VerticalResolution;
+    }
+
+    //
+    // The LVGL resolution is bounded by the primary output, the others are
+    // scaled to whatever mode they run.
+    //
+    Output = &uefi_disp_data->outputs[0];
+    backend = config != NULL ? config->backend : LV_UEFI_DISP_BACKEND_BLT;
+
+    //
+    // hor_res x ver_res is the LVGL (UI) resolution. Rotated by 90 or 270
+    // degrees it covers ver_res x hor_res of the screen.
+    //
+    uefi_disp_data->rotation = config != NULL ? config->rotation : LV_DISPLAY_ROTATION_0;
+    if (uefi_disp_data->rotation == LV_DISPLAY_ROTATION_90 || uefi_disp_data->rotation == LV_DISPLAY_ROTATION_270) {
+        uefi_disp_data->scr_hor_res = LV_MIN(ver_res, (int32_t)Output->hor_res);
+        uefi_disp_data->scr_ver_res = LV_MIN(hor_res, (int32_t)Output->ver_res);
+        uefi_disp_data->hor_res = uefi_disp_data->scr_ver_res;
+        uefi_disp_data->ver_res = uefi_disp_data->scr_hor_res;
+    } else {
+        uefi_disp_data->scr_hor_res = LV_MIN(hor_res, (int32_t)Output->hor_res);
+        uefi_disp_data->scr_ver_res = LV_MIN(ver_res, (int32_t)Output->ver_res);
+        uefi_disp_data->hor_res = uefi_disp_data->scr_hor_res;
+        uefi_disp_data->ver_res = uefi_disp_data->scr_ver_res;
+    }
+    hor_res = uefi_disp_data->hor_res;
+    ver_res = uefi_disp_data->ver_res;
+
+    //
+    // LVGL cannot render rotated into the framebuffer, rotate while flushing
+    // from a back buffer instead. Mirroring reads the rendered frame back
+    // for every output, which a framebuffer mapping is not meant for.
+    //
+    if ((uefi_disp_data->rotation != LV_DISPLAY_ROTATION_0 || OutputCnt > 1) &&
+        backend == LV_UEFI_DISP_BACKEND_LFB_DIRECT) {
+        backend = LV_UEFI_DISP_BACKEND_LFB_FLIP;
+    }
+    for (Index = 0; Index < OutputCnt; Index++) {
+        Output = &uefi_disp_data->outputs[Index];
+        Output->backend = uefi_disp_select_backend(Output, backend, hor_res, ver_res);
+    }
+    Output = &uefi_disp_data->outputs[0];
+    if (OutputCnt > 1) {
+        DebugPrint (DEBUG_INFO, "LVGL display: mirrored to %d outputs\n", OutputCnt);
+    }
 
     lv_display_t * disp = lv_display_create(hor_res, ver_res);
     if(NULL == disp) {
@@ -73,12 +1202,84 @@ lv_display_t * lv_uefi_disp_create(int32_t hor_res, int32_t ver_res)
     lv_display_set_driver_data(disp, uefi_disp_data);
     lv_display_set_flush_cb(disp, (lv_display_flush_cb_t)uefi_disp_flush);
     lv_display_add_event_cb(disp, uefi_disp_delete_evt_cb, LV_EVENT_DELETE, disp);
+    lv_display_add_event_cb(disp, uefi_disp_refr_evt_cb, LV_EVENT_REFR_START, disp);
+    lv_display_add_event_cb(disp, uefi_disp_refr_evt_cb, LV_EVENT_REFR_READY, disp);
+
+    for (Index = 0; Index < OutputCnt; Index++) {
+        if (uefi_disp_create_scaler(uefi_disp_data, &uefi_disp_data->outputs[Index]) != EFI_SUCCESS) {
+            DebugPrint (DEBUG_ERROR, "LVGL display: cannot allocate the scaler\n");
+            lv_display_delete(disp);
+            return NULL;
+        }
+    }
+
+    if (uefi_disp_data->rotation != LV_DISPLAY_ROTATION_0) {
+        uefi_disp_data->rotated = uefi_disp_malloc (uefi_disp_data->scr_hor_res * UEFI_DISP_ROTATE_LINES * sizeof(UINT32));
+        if (uefi_disp_data->rotated == NULL) {
+            DebugPrint (DEBUG_ERROR, "LVGL display: cannot allocate the rotation strip\n");
+            lv_display_delete(disp);
+            return NULL;
+        }
+    }
+
+    //
+    // Rendering straight into the framebuffer: LVGL keeps it as its only
+    // buffer, so no pool is needed and flushing is a no-op.
+    //
+    if (Output->backend == LV_UEFI_DISP_BACKEND_LFB_DIRECT) {
+        uefi_disp_data->render_mode = LV_DISPLAY_RENDER_MODE_DIRECT;
+        lv_display_set_buffers_with_stride(disp, Output->frame_buffer, NULL, Output->fb_stride * ver_res,
+                                           Output->fb_stride, LV_DISPLAY_RENDER_MODE_DIRECT);
+        return disp;
+    }
 
-    UINTN BufSize = hor_res * ver_res * sizeof (lv_color32_t);
-    uefi_disp_data->buffer[0] = malloc (BufSize);
-    uefi_disp_data->buffer[1] = malloc (BufSize);
+    render_mode = LV_DISPLAY_RENDER_MODE_DIRECT;
+    band_lines  = ver_res;
+    band_count  = 2;
+    if (config != NULL && config->render_mode == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        render_mode = LV_DISPLAY_RENDER_MODE_PARTIAL;
+        band_lines  = ver_res / LV_MAX(config->band_divisor, 1);
+        band_lines  = LV_MAX(band_lines, 1);
+        band_count  = LV_CLAMP(1, config->band_count, 2);
+    }
+
+    //
+    // A back buffer copied to the framebuffer is always complete after a
+    // flush, so a second direct buffer would only add a sync copy.
+    //
+    if (Output->backend == LV_UEFI_DISP_BACKEND_LFB_FLIP && render_mode == LV_DISPLAY_RENDER_MODE_DIRECT) {
+        band_count = 1;
+    }
 
-    lv_display_set_buffers(disp, uefi_disp_data->buffer[0], uefi_disp_data->buffer[1], BufSize, LV_DISPLAY_RENDER_MODE_DIRECT);
+    BufSize = hor_res * band_lines * sizeof (lv_color32_t);
+    uefi_disp_data->render_mode = render_mode;
+    uefi_disp_data->merge_slack = config != NULL ? config->merge_slack : 0;
+    uefi_disp_data->buffer[0] = uefi_disp_malloc (BufSize);
+    uefi_disp_data->buffer[1] = band_count > 1 ? uefi_disp_malloc (BufSize) : NULL;
+    if (uefi_disp_data->buffer[0] == NULL || (band_count > 1 && uefi_disp_data->buffer[1] == NULL)) {
+        DebugPrint (DEBUG_ERROR, "LVGL display: cannot allocate %d x %d bytes\n", band_count, (UINT32)BufSize);
+        lv_display_delete(disp);
+        return NULL;
+    }
+    uefi_disp_data->stats.buffer_bytes = BufSize * band_count;
+
+    //
+    // The shadow starts out zeroed. LVGL fills the XRGB8888 alpha byte with
+    // 0xFF, so the first refresh of any tile never matches it.
+    //
+    if (config != NULL && config->tile_diff) {
+        uefi_disp_data->shadow = uefi_disp_malloc (hor_res * ver_res * sizeof(UINT32));
+        if (uefi_disp_data->shadow != NULL) {
+            ZeroMem (uefi_disp_data->shadow, hor_res * ver_res * sizeof(UINT32));
+        }
+        if (uefi_disp_data->shadow == NULL) {
+            DebugPrint (DEBUG_WARN, "LVGL display: no memory for the tile diff shadow, disabled\n");
+        } else {
+            uefi_disp_data->stats.buffer_bytes += hor_res * ver_res * sizeof(UINT32);
+        }
+    }
+
+    lv_display_set_buffers(disp, uefi_disp_data->buffer[0], uefi_disp_data->buffer[1], BufSize, render_mode);
 
     return disp;
-}
\ No newline at end of file
+}
@@ -0,0 +1,308 @@
+/**
+ * @file lv_uefi_pixel.c
+ *
+ * Conversion of rendered lv_color32_t lines to the GOP framebuffer format,
+ * and upscaling of lines rendered below the GOP resolution.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_uefi_pixel.h"
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void pixel_bgrx8888(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    LV_UNUSED(fmt);
+    CopyMem (dst, src, count * sizeof(UINT32));
+}
+
+static void pixel_rgbx8888(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    UINT32 * d = (UINT32 *)dst;
+    UINT32   p;
+
+    LV_UNUSED(fmt);
+    while (count--) {
+        p = *src++;
+        *d++ = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+    }
+}
+
+static void pixel_rgb565(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    UINT16 * d = (UINT16 *)dst;
+    UINT32   p;
+
+    LV_UNUSED(fmt);
+    while (count--) {
+        p = *src++;
+        *d++ = (UINT16)(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+    }
+}
+
+static void pixel_bitmask(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    UINT32 p;
+    UINT32 v;
+
+    while (count--) {
+        p = *src++;
+        v = ((((p >> 16) & 0xFF) >> fmt->red_right) << fmt->red_left) |
+            ((((p >> 8) & 0xFF) >> fmt->green_right) << fmt->green_left) |
+            (((p & 0xFF) >> fmt->blue_right) << fmt->blue_left);
+
+        switch (fmt->bytes_per_pixel) {
+            case 4:
+                *(UINT32 *)dst = v;
+                break;
+            case 2:
+                *(UINT16 *)dst = (UINT16)v;
+                break;
+            default:
+                dst[0] = (UINT8)v;
+                if (fmt->bytes_per_pixel > 1) dst[1] = (UINT8)(v >> 8);
+                if (fmt->bytes_per_pixel > 2) dst[2] = (UINT8)(v >> 16);
+                break;
+        }
+        dst += fmt->bytes_per_pixel;
+    }
+}
+
+/**
+  Turn a channel mask into the shifts that place an 8 bit value in it.
+**/
+static void pixel_mask_shift(UINT32 mask, UINT8 * right, UINT8 * left)
+{
+    UINT32 low  = (UINT32)LowBitSet32(mask);
+    UINT32 bits = (UINT32)HighBitSet32(mask) - low + 1;
+
+    *right = (UINT8)(bits < 8 ? 8 - bits : 0);
+    *left  = (UINT8)(low + (bits > 8 ? bits - 8 : 0));
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+  Describe the framebuffer format of a GOP mode.
+
+  @retval EFI_SUCCESS       The format can be written by a conversion kernel.
+  @retval EFI_UNSUPPORTED   PixelBltOnly, or a bit mask with an empty channel.
+**/
+EFI_STATUS lv_uefi_pixel_format_init(lv_uefi_pixel_format_t * fmt, const EFI_GRAPHICS_OUTPUT_MODE_INFORMATION * info)
+{
+    const EFI_PIXEL_BITMASK * mask = &info->PixelInformation;
+    UINT32                    all;
+
+    ZeroMem (fmt, sizeof(*fmt));
+    fmt->bytes_per_pixel = sizeof(UINT32);
+
+    switch (info->PixelFormat) {
+        case PixelBlueGreenRedReserved8BitPerColor:
+            fmt->kind = LV_UEFI_PIXEL_BGRX8888;
+            return EFI_SUCCESS;
+
+        case PixelRedGreenBlueReserved8BitPerColor:
+            fmt->kind = LV_UEFI_PIXEL_RGBX8888;
+            return EFI_SUCCESS;
+
+        case PixelBitMask:
+            if (mask->RedMask == 0 || mask->GreenMask == 0 || mask->BlueMask == 0) {
+                return EFI_UNSUPPORTED;
+            }
+            all = mask->RedMask | mask->GreenMask | mask->BlueMask | mask->ReservedMask;
+            fmt->bytes_per_pixel = ((UINT32)HighBitSet32(all) + 8) / 8;
+
+            if (mask->RedMask == 0x00FF0000 && mask->GreenMask == 0x0000FF00 && mask->BlueMask == 0x000000FF &&
+                fmt->bytes_per_pixel == 4) {
+                fmt->kind = LV_UEFI_PIXEL_BGRX8888;
+            } else if (mask->RedMask == 0x000000FF && mask->GreenMask == 0x0000FF00 && mask->BlueMask == 0x00FF0000 &&
+                       fmt->bytes_per_pixel == 4) {
+                fmt->kind = LV_UEFI_PIXEL_RGBX8888;
+            } else if (mask->RedMask == 0xF800 && mask->GreenMask == 0x07E0 && mask->BlueMask == 0x001F &&
+                       fmt->bytes_per_pixel == 2) {
+                fmt->kind = LV_UEFI_PIXEL_RGB565;
+            } else {
+                fmt->kind = LV_UEFI_PIXEL_BITMASK;
+            }
+
+            pixel_mask_shift(mask->RedMask, &fmt->red_right, &fmt->red_left);
+            pixel_mask_shift(mask->GreenMask, &fmt->green_right, &fmt->green_left);
+            pixel_mask_shift(mask->BlueMask, &fmt->blue_right, &fmt->blue_left);
+            return EFI_SUCCESS;
+
+        default:
+            return EFI_UNSUPPORTED;
+    }
+}
+
+/**
+  Pick the conversion kernel for a framebuffer format, preferring the
+  NEON variants on AArch64.
+**/
+lv_uefi_pixel_convert_t lv_uefi_pixel_select(const lv_uefi_pixel_format_t * fmt)
+{
+    switch (fmt->kind) {
+        case LV_UEFI_PIXEL_BGRX8888:
+            return pixel_bgrx8888;
+
+        case LV_UEFI_PIXEL_RGBX8888:
+#if defined (MDE_CPU_AARCH64)
+            return lv_uefi_pixel_rgbx8888_neon;
+#else
+            return pixel_rgbx8888;
+#endif
+
+        case LV_UEFI_PIXEL_RGB565:
+#if defined (MDE_CPU_AARCH64)
+            return lv_uefi_pixel_rgb565_neon;
+#else
+            return pixel_rgb565;
+#endif
+
+        default:
+            return pixel_bitmask;
+    }
+}
+
+/**
+  Nearest neighbour upscale of one line.
+
+  @param  dst     Destination pixels.
+  @param  src     Source line, already offset so that x_map values index it.
+  @param  x_map   Source column of every destination pixel.
+  @param  count   Number of destination pixels.
+**/
+void lv_uefi_pixel_scale_row(UINT32 * dst, const UINT32 * src, const UINT32 * x_map, UINTN count)
+{
+    while (count >= 4) {
+        dst[0] = src[x_map[0]];
+        dst[1] = src[x_map[1]];
+        dst[2] = src[x_map[2]];
+        dst[3] = src[x_map[3]];
+        dst += 4;
+        x_map += 4;
+        count -= 4;
+    }
+    while (count--) {
+        *dst++ = src[*x_map++];
+    }
+}
+
+/**
+  Exact 2x upscale of one line: every source pixel is written twice with
+  a single 64 bit store. dst must be 8 byte aligned.
+**/
+void lv_uefi_pixel_scale_row_2x(UINT32 * dst, const UINT32 * src, UINTN src_count)
+{
+    UINT64 * d = (UINT64 *)dst;
+    UINT64   p;
+
+    while (src_count--) {
+        p = *src++;
+        *d++ = p | (p << 32);
+    }
+}
+
+/**
+  Compare two lines of pixels.
+
+  @retval TRUE    All count pixels are identical.
+**/
+BOOLEAN lv_uefi_pixel_row_equal(const UINT32 * a, const UINT32 * b, UINTN count)
+{
+#if defined (MDE_CPU_AARCH64)
+    return lv_uefi_pixel_row_equal_neon(a, b, count);
+#else
+    UINT32 diff = 0;
+
+    while (count >= 4) {
+        diff |= (a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]);
+        if (diff != 0) {
+            return FALSE;
+        }
+        a += 4;
+        b += 4;
+        count -= 4;
+    }
+    while (count--) {
+        diff |= *a++ ^ *b++;
+    }
+
+    return diff == 0;
+#endif
+}
+
+/**
+  Rotate a block of pixels clockwise.
+
+  The block is walked in LV_UEFI_PIXEL_ROTATE_BLOCK square tiles, so for
+  90 and 270 degrees the source lines of a tile and the destination lines
+  it is transposed into all stay in the data cache, instead of touching a
+  new destination line for every source pixel.
+
+  @param  dst         Destination, (h x w) for 90 and 270, (w x h) for 180.
+  @param  dst_stride  Destination line length in pixels.
+  @param  src         Source block of w x h pixels.
+  @param  src_stride  Source line length in pixels.
+  @param  rotation    LV_DISPLAY_ROTATION_90, _180 or _270.
+**/
+void lv_uefi_pixel_rotate(UINT32 * dst, UINTN dst_stride, const UINT32 * src, UINTN src_stride,
+                          UINTN w, UINTN h, lv_display_rotation_t rotation)
+{
+    const UINT32 * s;
+    UINT32       * d;
+    UINTN          bx, by, x, y, xe, ye;
+
+    if (rotation == LV_DISPLAY_ROTATION_180) {
+        for (y = 0; y < h; y++) {
+            s = src + y * src_stride;
+            d = dst + (h - 1 - y) * dst_stride + w;
+            for (x = 0; x < w; x++) {
+                *--d = *s++;
+            }
+        }
+        return;
+    }
+
+    for (by = 0; by < h; by += LV_UEFI_PIXEL_ROTATE_BLOCK) {
+        ye = LV_MIN(by + LV_UEFI_PIXEL_ROTATE_BLOCK, h);
+        for (bx = 0; bx < w; bx += LV_UEFI_PIXEL_ROTATE_BLOCK) {
+            xe = LV_MIN(bx + LV_UEFI_PIXEL_ROTATE_BLOCK, w);
+            for (x = bx; x < xe; x++) {
+                s = src + by * src_stride + x;
+                if (rotation == LV_DISPLAY_ROTATION_90) {
+                    /*(x, y) -> (h - 1 - y, x)*/
+                    d = dst + x * dst_stride + (h - 1 - by);
+                    for (y = by; y < ye; y++, s += src_stride) {
+                        *d-- = *s;
+                    }
+                } else {
+                    /*(x, y) -> (y, w - 1 - x)*/
+                    d = dst + (w - 1 - x) * dst_stride + by;
+                    for (y = by; y < ye; y++, s += src_stride) {
+                        *d++ = *s;
+                    }
+                }
+            }
+        }
+    }
+}
+
+#if defined (MDE_CPU_AARCH64)
+/* Scalar kernels for the unaligned head and the tail of the NEON variants */
+void lv_uefi_pixel_rgbx8888_scalar(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    pixel_rgbx8888(dst, src, count, fmt);
+}
+
+void lv_uefi_pixel_rgb565_scalar(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt)
+{
+    pixel_rgb565(dst, src, count, fmt);
+}
+#endif
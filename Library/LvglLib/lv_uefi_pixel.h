@@ -0,0 +1,78 @@
+/**
+ * @file lv_uefi_pixel.h
+ *
+ */
+
+#ifndef LV_UEFI_PIXEL_H
+#define LV_UEFI_PIXEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "LvglLibCommon.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/** Edge of the tiles lv_uefi_pixel_rotate() transposes at once: 16 lines of 64 bytes*/
+#define LV_UEFI_PIXEL_ROTATE_BLOCK  16
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    LV_UEFI_PIXEL_BGRX8888 = 0,     /**< Same layout as lv_color32_t, plain copy*/
+    LV_UEFI_PIXEL_RGBX8888,         /**< Red and blue swapped*/
+    LV_UEFI_PIXEL_RGB565,           /**< 16 bit, 0xF800/0x07E0/0x001F*/
+    LV_UEFI_PIXEL_BITMASK,          /**< Any other PixelBitMask layout*/
+} lv_uefi_pixel_kind_t;
+
+typedef struct {
+    lv_uefi_pixel_kind_t kind;
+    UINT32               bytes_per_pixel;
+    /* PixelBitMask: an 8 bit channel c is stored as (c >> right) << left */
+    UINT8                red_right, red_left;
+    UINT8                green_right, green_left;
+    UINT8                blue_right, blue_left;
+} lv_uefi_pixel_format_t;
+
+/** Convert one line of XRGB8888 (lv_color32_t) pixels to the framebuffer format*/
+typedef void (*lv_uefi_pixel_convert_t)(UINT8 * dst, const UINT32 * src, UINTN count,
+                                        const lv_uefi_pixel_format_t * fmt);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+EFI_STATUS lv_uefi_pixel_format_init(lv_uefi_pixel_format_t * fmt, const EFI_GRAPHICS_OUTPUT_MODE_INFORMATION * info);
+
+lv_uefi_pixel_convert_t lv_uefi_pixel_select(const lv_uefi_pixel_format_t * fmt);
+
+void lv_uefi_pixel_scale_row(UINT32 * dst, const UINT32 * src, const UINT32 * x_map, UINTN count);
+
+void lv_uefi_pixel_scale_row_2x(UINT32 * dst, const UINT32 * src, UINTN src_count);
+
+BOOLEAN lv_uefi_pixel_row_equal(const UINT32 * a, const UINT32 * b, UINTN count);
+
+void lv_uefi_pixel_rotate(UINT32 * dst, UINTN dst_stride, const UINT32 * src, UINTN src_stride,
+                          UINTN w, UINTN h, lv_display_rotation_t rotation);
+
+#if defined (MDE_CPU_AARCH64)
+void lv_uefi_pixel_rgbx8888_neon(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt);
+void lv_uefi_pixel_rgb565_neon(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt);
+void lv_uefi_pixel_rgbx8888_scalar(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt);
+void lv_uefi_pixel_rgb565_scalar(UINT8 * dst, const UINT32 * src, UINTN count, const lv_uefi_pixel_format_t * fmt);
+BOOLEAN lv_uefi_pixel_row_equal_neon(const UINT32 * a, const UINT32 * b, UINTN count);
+#endif
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_UEFI_PIXEL_H*/
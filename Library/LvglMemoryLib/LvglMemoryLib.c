@@ -0,0 +1,75 @@
+/** @file
+  Memory of the LVGL UI accounted per subsystem.
+
+  A BASE library, so that allocators below LvglLib such as the FreeType one
+  of FontLib can charge their blocks without linking the UI.
+
+  Copyright (c) 2025, viZPilot. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/LvglMemoryLib.h>
+
+STATIC LVGL_MEMORY_USAGE  mMemoryUsage[LvglMemoryTagMax];
+
+/**
+  Account a block of a subsystem growing from Freed to Allocated bytes.
+  An allocation passes 0 for Freed, a free 0 for Allocated, and a resize
+  counts as an allocation.
+
+  @param[in]  Tag         Subsystem.
+  @param[in]  Freed       Bytes given back, the old size of a resized block.
+  @param[in]  Allocated   Bytes taken, the new size of a resized block.
+**/
+VOID
+EFIAPI
+LvglMemoryCharge (
+  IN LVGL_MEMORY_TAG      Tag,
+  IN UINTN                Freed,
+  IN UINTN                Allocated
+  )
+{
+  LVGL_MEMORY_USAGE  *Usage;
+
+  ASSERT (Tag < LvglMemoryTagMax);
+  if (Tag >= LvglMemoryTagMax) {
+    return;
+  }
+
+  Usage = &mMemoryUsage[Tag];
+  Usage->CurrentBytes = Usage->CurrentBytes - Freed + Allocated;
+  Usage->PeakBytes = MAX (Usage->PeakBytes, Usage->CurrentBytes);
+  if (Allocated != 0) {
+    Usage->Allocations++;
+  } else if (Freed != 0) {
+    Usage->Frees++;
+  }
+}
+
+/**
+  Get the memory held by a subsystem, to size platform memory maps.
+
+  @param[in]  Tag       Subsystem.
+  @param[out] Usage     Bytes held now and at most, allocation counts.
+
+  @retval RETURN_SUCCESS            Usage was filled in.
+  @retval RETURN_INVALID_PARAMETER  Tag is out of range or Usage is NULL.
+**/
+RETURN_STATUS
+EFIAPI
+LvglMemoryGetUsage (
+  IN  LVGL_MEMORY_TAG     Tag,
+  OUT LVGL_MEMORY_USAGE   *Usage
+  )
+{
+  if (Tag >= LvglMemoryTagMax || Usage == NULL) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  CopyMem (Usage, &mMemoryUsage[Tag], sizeof (*Usage));
+  return RETURN_SUCCESS;
+}